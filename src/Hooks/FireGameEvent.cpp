@@ -25,15 +25,21 @@
 #include "hooks.hpp"
 #include "../config.hpp"
 #include "../nSkinz.hpp"
+#include "../local_player.hpp"
+#include "../profiler.hpp"
 
 auto __fastcall hooks::SFHudDeathNoticeAndBotStatus_FireGameEvent::hooked(void* thisptr, void*, sdk::IGameEvent* event) -> void
 {
+	profiler::scoped_timer timer(profiler::hook_id::fire_game_event);
+
 	// Filter to only the events we're interested in.
 	if(fnv::hash_runtime(event->GetName()) == FNV("player_death")
-		&& g_engine->GetPlayerForUserID(event->GetInt("attacker")) == g_engine->GetLocalPlayer())
+		&& g_engine->GetPlayerForUserID(event->GetInt("attacker")) == local_player::get().index)
 		if(const auto icon_override = g_config.get_icon_override(event->GetString("weapon")))
 			event->SetString("weapon", icon_override);
 
+	timer.stop();
+
 	m_original(thisptr, nullptr, event);
 }
 
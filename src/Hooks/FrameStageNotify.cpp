@@ -0,0 +1,31 @@
+#include "hooks.hpp"
+#include "../model_changer.hpp"
+#include "../local_player.hpp"
+#include "../sticker_changer.hpp"
+#include "../frame_scheduler.hpp"
+#include "../hot_reload.hpp"
+
+auto __fastcall hooks::FrameStageNotify::hooked(sdk::IBaseClientDLL* thisptr, void*, sdk::ClientFrameStage_t stage) -> void
+{
+	// Runs on the game thread, unlike the menu which draws from EndScene
+	if(stage == sdk::FRAME_RENDER_START)
+	{
+		model_changer::run_precache_queue();
+		update_sticker_table();
+		hot_reload::update();
+
+		// Last, after the above have queued this frame's engine work
+		frame_scheduler::run();
+	}
+
+	// Entities are created and deleted while the update is read, the post
+	// data update stage sees the final set
+	if(stage == sdk::FRAME_NET_UPDATE_START)
+		local_player::begin_network_update();
+	else if(stage == sdk::FRAME_NET_UPDATE_POSTDATAUPDATE_START)
+		local_player::end_network_update();
+
+	m_original(thisptr, nullptr, stage);
+}
+
+hooks::FrameStageNotify::Fn* hooks::FrameStageNotify::m_original;
@@ -25,6 +25,9 @@
 #pragma once
 #include "../SDK.hpp"
 
+#include <atomic>
+#include <vector>
+
 namespace hooks
 {
 	struct CCSPlayer_PostDataUpdate
@@ -41,6 +44,32 @@ namespace hooks
 		static Fn* m_original;
 	};
 
+	struct FrameStageNotify
+	{
+		using Fn = void __fastcall(sdk::IBaseClientDLL* thisptr, void*, sdk::ClientFrameStage_t stage);
+		static Fn hooked;
+		static Fn* m_original;
+	};
+
+	// How often PostDataUpdate wrote the config to an item versus found it already applied
+	struct item_apply_counters
+	{
+		std::atomic<unsigned> applied{ 0 };
+		std::atomic<unsigned> skipped{ 0 };
+		std::atomic<unsigned> refreshed{ 0 };
+	};
+
+	extern item_apply_counters g_item_apply_counters;
+
+	// Applies the config again to the local player's weapons, glove and view
+	// model whose config is for one of these definition indices, and has them
+	// rebuild their visuals, instead of a full update. Game thread only.
+	auto refresh_items(const std::vector<int>& definitions) -> void;
+
+	// Times ensure_dynamic_hooks found something to hook. The sequence proxy
+	// that calls it is timed by the profiler.
+	extern std::atomic<unsigned> g_dynamic_hook_installs;
+
 	// NetVar Proxies
 
 	extern auto __cdecl sequence_proxy_fn(const sdk::CRecvProxyData* proxy_data_const, void* entity, void* output) -> void;
@@ -25,29 +25,15 @@
 #include "hooks.hpp"
 #include "../item_definitions.hpp"
 #include "../nSkinz.hpp"
-#include "../config.hpp"
 #include "../sticker_changer.hpp"
 #include "../model_changer.hpp"
+#include "../model_index_cache.hpp"
+#include "../local_player.hpp"
+#include "../profiler.hpp"
+#include "../item_plans.hpp"
 
-static auto erase_override_if_exists_by_index(const int definition_index) -> void
-{
-	// We have info about the item not needed to be overridden
-	if(const auto original_item = game_data::get_weapon_info(definition_index))
-	{
-		auto& icon_override_map = g_config.get_icon_override_map();
-
-		if (!original_item->icon)
-			return;
-
-		const auto override_entry = icon_override_map.find(original_item->icon);
-
-		// We are overriding its icon when not needed
-		if(override_entry != end(icon_override_map))
-			icon_override_map.erase(override_entry); // Remove the leftover override
-	}
-}
-
-static auto apply_config_on_attributable_item(sdk::C_BaseAttributableItem* item, const item_setting* config,
+// Only the writes the plan has, the checks were made when it was compiled
+static auto apply_config_on_attributable_item(sdk::C_BaseAttributableItem* item, const item_plans::plan* plan,
 	const unsigned xuid_low) -> void
 {
 	// Force fallback values to be used.
@@ -56,59 +42,90 @@ static auto apply_config_on_attributable_item(sdk::C_BaseAttributableItem* item,
 	// Set the owner of the weapon to our lower XUID. (fixes StatTrak)
 	item->GetAccountID() = xuid_low;
 
-	if(config->entity_quality_index)
-		item->GetEntityQuality() = config->entity_quality_index;
+	if(plan->has(item_plans::quality))
+		item->GetEntityQuality() = plan->quality;
 
-	if(config->custom_name[0])
-		strcpy_s(item->GetCustomName(), config->custom_name);
+	if(plan->has(item_plans::custom_name))
+		strcpy_s(item->GetCustomName(), plan->custom_name);
 
-	if(config->paint_kit_index)
-		item->GetFallbackPaintKit() = config->paint_kit_index;
+	if(plan->has(item_plans::paint_kit))
+		item->GetFallbackPaintKit() = plan->paint_kit;
 
-	if(config->seed)
-		item->GetFallbackSeed() = config->seed;
+	if(plan->has(item_plans::seed))
+		item->GetFallbackSeed() = plan->seed;
 
-	if(config->stat_trak)
-		item->GetFallbackStatTrak() = config->stat_trak;
+	if(plan->has(item_plans::stat_trak))
+		item->GetFallbackStatTrak() = plan->stat_trak;
 
-	item->GetFallbackWear() = config->wear;
+	item->GetFallbackWear() = plan->wear;
 
 	auto& definition_index = item->GetItemDefinitionIndex();
 
-	auto& icon_override_map = g_config.get_icon_override_map();
-
-	if(config->definition_override_index // We need to override defindex
-		&& config->definition_override_index != definition_index) // It is not yet overridden
+	// It is not yet overridden. The kill feed icon was mapped when the plan was compiled.
+	if(plan->has(item_plans::definition_override) && plan->definition_override != definition_index)
 	{
-		// We have info about what we gonna override it to
-		if(const auto replacement_item = game_data::get_weapon_info(config->definition_override_index))
-		{
-			const auto old_definition_index = definition_index;
+		definition_index = plan->definition_override;
+
+		// Set the weapon model index -- required for paint kits to work on replacement items after the 29/11/2016 update.
+		// Looked up again if it wasn't precached yet when the plan was made.
+		item->SetModelIndex(plan->override_model_index >= 0
+			? plan->override_model_index
+			: model_index_cache::get_model_index(plan->definition_override));
+		item->GetClientNetworkable()->PreDataUpdate(0);
+	}
 
-			definition_index = short(config->definition_override_index);
+	apply_sticker_changer(item);
+}
 
-			// Set the weapon model index -- required for paint kits to work on replacement items after the 29/11/2016 update.
-			//item->GetModelIndex() = g_model_info->GetModelIndex(k_weapon_info.at(config->definition_override_index).model);
-			item->SetModelIndex(g_model_info->GetModelIndex(replacement_item->model));
-			item->GetClientNetworkable()->PreDataUpdate(0);
+hooks::item_apply_counters hooks::g_item_apply_counters;
 
-			// We didn't override 0, but some actual weapon, that we have data for
-			if(old_definition_index)
-			{
-				if(const auto original_item = game_data::get_weapon_info(old_definition_index))
-				{
-					if(original_item->icon && replacement_item->icon)
-						icon_override_map[original_item->icon] = replacement_item->icon;
-				}
-			}
-		}
-	}
-	else
+// What we last wrote to the entity in each slot. PostDataUpdate runs for every
+// network update of the local player, while the config only changes from the
+// menu or a reload, so most calls would write the exact same values again.
+struct applied_item
+{
+	sdk::CBaseHandle handle = sdk::INVALID_EHANDLE_INDEX;
+	unsigned generation = 0;
+	short definition_index = 0;
+	unsigned paint_kit = 0;
+	float wear = 0.f;
+	unsigned xuid_low = 0;
+};
+
+static std::array<applied_item, 0x1000> s_applied_items;
+
+static auto apply_config_if_changed(sdk::C_BaseAttributableItem* item, const sdk::CBaseHandle handle,
+	const item_plans::plan* plan, const unsigned xuid_low) -> void
+{
+	// What the plans were built from, an edit made since still counts as a change next time
+	const auto generation = item_plans::get_generation();
+
+	auto& applied = s_applied_items[handle & 0xFFF];
+
+	// A full update or the server sending the item again resets the fallback
+	// values, so the entity itself has to still hold what we wrote too
+	if(applied.handle == handle
+		&& applied.generation == generation
+		&& applied.xuid_low == xuid_low
+		&& applied.definition_index == item->GetItemDefinitionIndex()
+		&& item->GetItemIDHigh() == -1
+		&& item->GetAccountID() == int(xuid_low)
+		&& item->GetFallbackPaintKit() == applied.paint_kit
+		&& item->GetFallbackWear() == applied.wear)
 	{
-		erase_override_if_exists_by_index(definition_index);
+		++hooks::g_item_apply_counters.skipped;
+		return;
 	}
 
-	apply_sticker_changer(item);
+	apply_config_on_attributable_item(item, plan, xuid_low);
+	++hooks::g_item_apply_counters.applied;
+
+	applied.handle = handle;
+	applied.generation = generation;
+	applied.xuid_low = xuid_low;
+	applied.definition_index = item->GetItemDefinitionIndex();
+	applied.paint_kit = item->GetFallbackPaintKit();
+	applied.wear = item->GetFallbackWear();
 }
 
 static auto get_wearable_create_fn() -> sdk::CreateClientClassFn
@@ -147,10 +164,65 @@ static auto make_glove(int entry, int serial) -> sdk::C_BaseAttributableItem*
 	return glove;
 }
 
+// All knives are terrorist knives.
+static auto get_config_index(const int definition_index) -> int
+{
+	return is_knife(definition_index) ? WEAPON_KNIFE : definition_index;
+}
+
+static auto apply_view_model(const local_player::snapshot& snapshot) -> void
+{
+	const auto view_model = snapshot.view_model.entity;
+
+	if(!view_model)
+		return;
+
+	const auto view_model_weapon = snapshot.active_weapon.entity;
+
+	if(!view_model_weapon)
+		return;
+
+	const auto override_definition_index = view_model_weapon->GetItemDefinitionIndex();
+
+	if(!game_data::get_weapon_info(override_definition_index))
+		return;
+
+	int override_model_index = model_index_cache::get_model_index(override_definition_index);
+	int custom_idx = model_index_cache::get_replacement_index(override_definition_index);
+	
+	if (custom_idx > 0)
+	{
+		view_model->GetModelIndex() = custom_idx;
+	}
+	else
+	{
+		view_model->GetModelIndex() = override_model_index;
+	}
+
+	const auto world_model = get_entity_from_handle<sdk::CBaseWeaponWorldModel>(view_model_weapon->GetWeaponWorldModel());
+
+	if(!world_model)
+		return;
+
+	// Always use the default world model index (override_model_index + 1)
+	// because custom viewmodels almost never include custom world models.
+	// This prevents the giant red ERROR sign!
+	world_model->GetModelIndex() = override_model_index + 1;
+}
+
 static auto post_data_update_start(sdk::C_BasePlayer* local) -> void
 {
 	const auto local_index = local->GetIndex();
 
+	// The hook sits on the local player only, but it may have been recreated since
+	if(local_player::get().player != local)
+		local_player::invalidate();
+
+	const auto& snapshot = local_player::get();
+
+	if(snapshot.player != local)
+		return;
+
 	/*if(auto player_resource = *g_player_resource)
 	{
 		player_resource->GetCoins()[local_index] = 890;
@@ -163,11 +235,13 @@ static auto post_data_update_start(sdk::C_BasePlayer* local) -> void
 	if(!g_engine->GetPlayerInfo(local_index, &player_info))
 		return;
 
+	item_plans::update();
+
 	// Handle glove config
 	{
 		const auto wearables = local->GetWearables();
 
-		const auto glove_config = g_config.get_by_definition_index(GLOVE_T_SIDE);
+		const auto glove_plan = item_plans::find(GLOVE_T_SIDE);
 
 		static auto glove_handle = sdk::CBaseHandle(0);
 
@@ -197,7 +271,7 @@ static auto post_data_update_start(sdk::C_BasePlayer* local) -> void
 			return;
 		}
 
-		if(glove_config && glove_config->definition_override_index)
+		if(glove_plan && glove_plan->has(item_plans::definition_override))
 		{
 			// We don't have a glove, but we should
 			if(!glove)
@@ -216,75 +290,118 @@ static auto post_data_update_start(sdk::C_BasePlayer* local) -> void
 			// Thanks, Beakers
 			glove->GetIndex() = -1;
 
-			apply_config_on_attributable_item(glove, glove_config, player_info.xuid_low);
+			apply_config_if_changed(glove, wearables[0], glove_plan, player_info.xuid_low);
 		}
 	}
 
 	// Handle weapon configs
 	{
-		auto& weapons = local->GetWeapons();
-
-		for(auto weapon_handle : weapons)
+		for(auto i = 0; i < snapshot.weapon_count; ++i)
 		{
-			if(weapon_handle == sdk::INVALID_EHANDLE_INDEX)
-				break;
-
-			auto weapon = get_entity_from_handle<sdk::C_BaseAttributableItem>(weapon_handle);
+			const auto weapon_handle = snapshot.weapons[i].handle;
+			const auto weapon = snapshot.weapons[i].entity;
 
 			if(!weapon)
 				continue;
 
 			auto& definition_index = weapon->GetItemDefinitionIndex();
 
-			// All knives are terrorist knives.
-			if(const auto active_conf = g_config.get_by_definition_index(is_knife(definition_index) ? WEAPON_KNIFE : definition_index))
-				apply_config_on_attributable_item(weapon, active_conf, player_info.xuid_low);
-			else
-				erase_override_if_exists_by_index(definition_index);
+			if(const auto plan = item_plans::find(get_config_index(definition_index)))
+				apply_config_if_changed(weapon, weapon_handle, plan, player_info.xuid_low);
+
+			// Lazy precaching: queue the replacement the first time we hold the weapon
+			if(model_changer::g_lazy_precache)
+			{
+				if(const auto weapon_info = game_data::get_weapon_info(definition_index))
+					model_changer::request_model(weapon_info->model);
+				else if(const auto model = g_model_info->GetModel(weapon->GetViewModelIndex()))
+					model_changer::request_model(g_model_info->GetModelName(model));
+			}
 		}
 	}
 
-	const auto view_model = get_entity_from_handle<sdk::C_BaseViewModel>(local->GetViewModel());
+	apply_view_model(snapshot);
+}
 
-	if(!view_model)
-		return;
+// Forgets what was applied so the config is written again, inside a data
+// update like the engine runs for a received packet. The custom materials
+// aren't rebuilt this way, config::diff_items asks for a full update when
+// the paint, stickers or model change.
+static auto refresh_item(sdk::C_BaseAttributableItem* item, const sdk::CBaseHandle handle,
+	const item_plans::plan* plan, const unsigned xuid_low) -> void
+{
+	const auto networkable = item->GetClientNetworkable();
+	networkable->PreDataUpdate(0);
 
-	const auto view_model_weapon = get_entity_from_handle<sdk::C_BaseAttributableItem>(view_model->GetWeapon());
+	s_applied_items[handle & 0xFFF].handle = sdk::INVALID_EHANDLE_INDEX;
+	apply_config_if_changed(item, handle, plan, xuid_low);
 
-	if(!view_model_weapon)
-		return;
+	networkable->PostDataUpdate(0);
+	networkable->OnDataChanged(0);
+
+	++hooks::g_item_apply_counters.refreshed;
+}
 
-	const auto override_info = game_data::get_weapon_info(view_model_weapon->GetItemDefinitionIndex());
+auto hooks::refresh_items(const std::vector<int>& definitions) -> void
+{
+	const auto& snapshot = local_player::get();
 
-	if(!override_info)
+	if(!snapshot.player || !snapshot.alive)
 		return;
 
-	int override_model_index = g_model_info->GetModelIndex(override_info->model);
-	int custom_idx = model_changer::get_replacement_index(override_info->model);
-	
-	if (custom_idx > 0)
+	sdk::player_info_t player_info;
+	if(!g_engine->GetPlayerInfo(snapshot.index, &player_info))
+		return;
+
+	item_plans::update();
+
+	const auto is_changed = [&definitions](const int definition_index)
 	{
-		view_model->GetModelIndex() = custom_idx;
-	}
-	else
+		return std::find(definitions.begin(), definitions.end(), definition_index) != definitions.end();
+	};
+
+	if(is_changed(GLOVE_T_SIDE))
 	{
-		view_model->GetModelIndex() = override_model_index;
+		const auto wearables = snapshot.player->GetWearables();
+		const auto glove = get_entity_from_handle<sdk::C_BaseAttributableItem>(wearables[0]);
+		const auto glove_plan = item_plans::find(GLOVE_T_SIDE);
+
+		// A glove we still have to create is made by the next PostDataUpdate
+		if(glove && glove_plan && glove_plan->has(item_plans::definition_override))
+			refresh_item(glove, wearables[0], glove_plan, player_info.xuid_low);
 	}
 
-	const auto world_model = get_entity_from_handle<sdk::CBaseWeaponWorldModel>(view_model_weapon->GetWeaponWorldModel());
+	auto active_changed = false;
 
-	if(!world_model)
-		return;
+	for(auto i = 0; i < snapshot.weapon_count; ++i)
+	{
+		const auto weapon = snapshot.weapons[i].entity;
 
-	// Always use the default world model index (override_model_index + 1)
-	// because custom viewmodels almost never include custom world models.
-	// This prevents the giant red ERROR sign!
-	world_model->GetModelIndex() = override_model_index + 1;
+		if(!weapon)
+			continue;
+
+		const auto config_index = get_config_index(weapon->GetItemDefinitionIndex());
+		if(!is_changed(config_index))
+			continue;
+
+		if(const auto plan = item_plans::find(config_index))
+		{
+			refresh_item(weapon, snapshot.weapons[i].handle, plan, player_info.xuid_low);
+			active_changed |= weapon == snapshot.active_weapon.entity;
+		}
+	}
+
+	// An override changes the model the view model has to show
+	if(active_changed)
+		apply_view_model(snapshot);
 }
 
 auto __fastcall hooks::CCSPlayer_PostDataUpdate::hooked(sdk::IClientNetworkable* thisptr, void*, int update_type) -> void
 {
-	post_data_update_start(static_cast<sdk::C_BasePlayer*>(thisptr));
+	{
+		profiler::scoped_timer timer(profiler::hook_id::post_data_update);
+		post_data_update_start(static_cast<sdk::C_BasePlayer*>(thisptr));
+	}
 
 	return m_original(thisptr, nullptr, update_type);
 }
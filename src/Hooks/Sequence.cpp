@@ -25,205 +25,71 @@
 #include "hooks.hpp"
 #include "../nSkinz.hpp"
 #include "../config.hpp"
-
-static auto random_sequence(const int low, const int high) -> int
-{
-	return rand() % (high - low + 1) + low;
-}
-
-// This only fixes if the original knife was a default knife.
-// The best would be having a function that converts original knife's sequence
-// into some generic enum, then another function that generates a sequence
-// from the sequences of the new knife. I won't write that.
-static auto get_new_animation(const fnv::hash model, const int sequence) -> int
-{
-	enum ESequence
-	{
-		SEQUENCE_DEFAULT_DRAW = 0,
-		SEQUENCE_DEFAULT_IDLE1 = 1,
-		SEQUENCE_DEFAULT_IDLE2 = 2,
-		SEQUENCE_DEFAULT_LIGHT_MISS1 = 3,
-		SEQUENCE_DEFAULT_LIGHT_MISS2 = 4,
-		SEQUENCE_DEFAULT_HEAVY_MISS1 = 9,
-		SEQUENCE_DEFAULT_HEAVY_HIT1 = 10,
-		SEQUENCE_DEFAULT_HEAVY_BACKSTAB = 11,
-		SEQUENCE_DEFAULT_LOOKAT01 = 12,
-
-		SEQUENCE_BUTTERFLY_DRAW = 0,
-		SEQUENCE_BUTTERFLY_DRAW2 = 1,
-		SEQUENCE_BUTTERFLY_LOOKAT01 = 13,
-		SEQUENCE_BUTTERFLY_LOOKAT03 = 15,
-
-		SEQUENCE_FALCHION_IDLE1 = 1,
-		SEQUENCE_FALCHION_HEAVY_MISS1 = 8,
-		SEQUENCE_FALCHION_HEAVY_MISS1_NOFLIP = 9,
-		SEQUENCE_FALCHION_LOOKAT01 = 12,
-		SEQUENCE_FALCHION_LOOKAT02 = 13,
-		
-		SEQUENCE_CSS_LOOKAT01 = 14,
-		SEQUENCE_CSS_LOOKAT02 = 15,
-
-		SEQUENCE_DAGGERS_IDLE1 = 1,
-		SEQUENCE_DAGGERS_LIGHT_MISS1 = 2,
-		SEQUENCE_DAGGERS_LIGHT_MISS5 = 6,
-		SEQUENCE_DAGGERS_HEAVY_MISS2 = 11,
-		SEQUENCE_DAGGERS_HEAVY_MISS1 = 12,
-
-		SEQUENCE_BOWIE_IDLE1 = 1,
-	};
-
-	// Hashes for best performance.
-	switch(model)
-	{
-	case FNV("models/weapons/v_knife_butterfly.mdl"):
-		{
-			switch(sequence)
-			{
-			case SEQUENCE_DEFAULT_DRAW:
-				return random_sequence(SEQUENCE_BUTTERFLY_DRAW, SEQUENCE_BUTTERFLY_DRAW2);
-			case SEQUENCE_DEFAULT_LOOKAT01:
-				return random_sequence(SEQUENCE_BUTTERFLY_LOOKAT01, SEQUENCE_BUTTERFLY_LOOKAT03);
-			default:
-				return sequence + 1;
-			}
-		}
-	case FNV("models/weapons/v_knife_falchion_advanced.mdl"):
-		{
-			switch(sequence)
-			{
-			case SEQUENCE_DEFAULT_IDLE2:
-				return SEQUENCE_FALCHION_IDLE1;
-			case SEQUENCE_DEFAULT_HEAVY_MISS1:
-				return random_sequence(SEQUENCE_FALCHION_HEAVY_MISS1, SEQUENCE_FALCHION_HEAVY_MISS1_NOFLIP);
-			case SEQUENCE_DEFAULT_LOOKAT01:
-				return random_sequence(SEQUENCE_FALCHION_LOOKAT01, SEQUENCE_FALCHION_LOOKAT02);
-			case SEQUENCE_DEFAULT_DRAW:
-			case SEQUENCE_DEFAULT_IDLE1:
-				return sequence;
-			default:
-				return sequence - 1;
-			}
-		}
-	case FNV("models/weapons/v_knife_css.mdl"):
-	{
-		switch (sequence)
-		{
-		case SEQUENCE_DEFAULT_LOOKAT01:
-			return random_sequence(0, 1) ? 12 : 15;
-		default:
-			return sequence;
-		}
-	}
-	case FNV("models/weapons/v_knife_push.mdl"):
-		{
-			switch(sequence)
-			{
-			case SEQUENCE_DEFAULT_IDLE2:
-				return SEQUENCE_DAGGERS_IDLE1;
-			case SEQUENCE_DEFAULT_LIGHT_MISS1:
-			case SEQUENCE_DEFAULT_LIGHT_MISS2:
-				return random_sequence(SEQUENCE_DAGGERS_LIGHT_MISS1, SEQUENCE_DAGGERS_LIGHT_MISS5);
-			case SEQUENCE_DEFAULT_HEAVY_MISS1:
-				return random_sequence(SEQUENCE_DAGGERS_HEAVY_MISS2, SEQUENCE_DAGGERS_HEAVY_MISS1);
-			case SEQUENCE_DEFAULT_HEAVY_HIT1:
-			case SEQUENCE_DEFAULT_HEAVY_BACKSTAB:
-			case SEQUENCE_DEFAULT_LOOKAT01:
-				return sequence + 3;
-			case SEQUENCE_DEFAULT_DRAW:
-			case SEQUENCE_DEFAULT_IDLE1:
-				return sequence;
-			default:
-				return sequence + 2;
-			}
-		}
-	case FNV("models/weapons/v_knife_survival_bowie.mdl"):
-		{
-			switch(sequence)
-			{
-			case SEQUENCE_DEFAULT_DRAW:
-			case SEQUENCE_DEFAULT_IDLE1:
-				return sequence;
-			case SEQUENCE_DEFAULT_IDLE2:
-				return SEQUENCE_BOWIE_IDLE1;
-			default:
-				return sequence - 1;
-			}
-		}
-	case FNV("models/weapons/v_knife_ursus.mdl"):
-	case FNV("models/weapons/v_knife_cord.mdl"):
-	case FNV("models/weapons/v_knife_canis.mdl"):
-	case FNV("models/weapons/v_knife_outdoor.mdl"):
-	case FNV("models/weapons/v_knife_skeleton.mdl"):
-		{
-			switch (sequence)
-			{
-			case SEQUENCE_DEFAULT_DRAW:
-				return random_sequence(SEQUENCE_BUTTERFLY_DRAW, SEQUENCE_BUTTERFLY_DRAW2);
-			case SEQUENCE_DEFAULT_LOOKAT01:
-				return random_sequence(SEQUENCE_BUTTERFLY_LOOKAT01, 14);
-			default:
-				return sequence + 1;
-			}
-		}
-	case FNV("models/weapons/v_knife_stiletto.mdl"):
-		{
-			switch (sequence)
-			{
-			case SEQUENCE_DEFAULT_LOOKAT01:
-				return random_sequence(12, 13);
-			default:
-				return sequence;
-			}
-		}
-	case FNV("models/weapons/v_knife_widowmaker.mdl"):
-		{
-			switch (sequence)
-			{
-			case SEQUENCE_DEFAULT_LOOKAT01:
-				return random_sequence(14, 15);
-			default:
-				return sequence;
-			}
-		}
-	default:
-		return sequence;
-	}
-}
+#include "../sequence_remap.hpp"
+#include "../model_index_cache.hpp"
+#include "../item_definitions.hpp"
+#include "../local_player.hpp"
+#include "../profiler.hpp"
 
 static auto do_sequence_remapping(sdk::CRecvProxyData* data, sdk::C_BaseViewModel* entity) -> void
 {
-	const auto local = static_cast<sdk::C_BasePlayer*>(g_entity_list->GetClientEntity(g_engine->GetLocalPlayer()));
+	const auto& local = local_player::get();
 
-	if(!local)
+	if(!local.player)
 		return;
 
-	if(local->GetLifeState() != sdk::LifeState::ALIVE)
+	if(!local.alive)
 		return;
 
-	const auto owner = get_entity_from_handle<sdk::C_BasePlayer>(entity->GetOwner());
-
-	if(owner != local)
+	// Usually our view model from the snapshot, unless it was created since
+	if(entity != local.view_model.entity && get_entity_from_handle<sdk::C_BasePlayer>(entity->GetOwner()) != local.player)
 		return;
 
-	const auto view_model_weapon = get_entity_from_handle<sdk::C_BaseAttributableItem>(entity->GetWeapon());
+	const auto view_model_weapon = local_player::get_weapon(entity->GetWeapon());
 
 	if(!view_model_weapon)
 		return;
 
-	const auto weapon_info = game_data::get_weapon_info(view_model_weapon->GetItemDefinitionIndex());
+	const auto definition_index = view_model_weapon->GetItemDefinitionIndex();
+	const auto weapon_info = game_data::get_weapon_info(definition_index);
 
 	if(!weapon_info)
 		return;
 
-	const auto override_model = weapon_info->model;
-
 	auto& sequence = data->m_Value.m_Int;
-	sequence = get_new_animation(fnv::hash_runtime(override_model), sequence);
+
+	// The server plays the sequences of the model it thinks we hold. For knives
+	// that is a default knife, all knives are terrorist knives like in PostDataUpdate.
+	const auto source_index = is_knife(definition_index) ? WEAPON_KNIFE : definition_index;
+	const auto custom_index = model_index_cache::get_replacement_index(definition_index);
+
+	if(custom_index <= 0)
+	{
+		// Hand written tables know the quirks of the stock knives better
+		if(sequence_remap::has_table(weapon_info->model_hash) || source_index == definition_index)
+		{
+			sequence = sequence_remap::remap(weapon_info->model_hash, sequence);
+			return;
+		}
+	}
+
+	const auto source_model = g_model_info->GetModel(model_index_cache::get_model_index(source_index));
+	const auto target_model = g_model_info->GetModel(custom_index > 0 ? custom_index : model_index_cache::get_model_index(definition_index));
+
+	if(!source_model || !target_model || source_model == target_model)
+		return;
+
+	const auto target_hash = custom_index > 0 ? fnv::hash_runtime(g_model_info->GetModelName(target_model)) : weapon_info->model_hash;
+
+	sequence = sequence_remap::remap_by_activity(game_data::get_weapon_info(source_index)->model_hash, g_model_info->GetStudioModel(source_model),
+		target_hash, g_model_info->GetStudioModel(target_model), sequence);
 }
 
 // Replacement function that will be called when the view model animation sequence changes.
 auto __cdecl hooks::sequence_proxy_fn(const sdk::CRecvProxyData* proxy_data_const, void* entity, void* output) -> void
 {
+	profiler::scoped_timer timer(profiler::hook_id::sequence_proxy);
+
 	// Ensure our other dynamic object hooks are in place.
 	// Must do this from a game thread.
 	ensure_dynamic_hooks();
@@ -237,6 +103,10 @@ auto __cdecl hooks::sequence_proxy_fn(const sdk::CRecvProxyData* proxy_data_cons
 
 	do_sequence_remapping(proxy_data, view_model);
 
+	timer.stop();
+
 	// Call the original function with our edited data.
 	original_fn(proxy_data_const, entity, output);
 }
+
+std::atomic<unsigned> hooks::g_dynamic_hook_installs{ 0 };
@@ -59,6 +59,11 @@ namespace sdk
 			return get_vfunc<bool(__thiscall *)(IVEngineClient*)>(this, 27)(this);
 		}
 
+		const char* GetLevelName()
+		{
+			return get_vfunc<const char*(__thiscall *)(IVEngineClient*)>(this, 52)(this);
+		}
+
 		void ClientCmd_Unrestricted(const char* command, const bool delayed = false)
 		{
 			return get_vfunc<void(__thiscall *)(IVEngineClient*, const char*, bool)>(this, 114)(this, command, delayed);
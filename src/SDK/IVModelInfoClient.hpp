@@ -10,6 +10,13 @@ namespace sdk
 		virtual int				GetModelIndex(const char* name) const = 0;
 		virtual const char*		GetModelName(const model_t* model) const = 0;
 
+		// studiohdr_t, laid out like the start of the .mdl file
+		const void* GetStudioModel(const model_t* model)
+		{
+			typedef const void*(__thiscall* fn)(void*, const model_t*);
+			return get_vfunc<fn>(this, 32)(this, model);
+		}
+
 		void* FindOrLoadModel(const char* name)
 		{
 			typedef void*(__thiscall* fn)(void*, const char*);
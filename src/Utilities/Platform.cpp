@@ -24,14 +24,61 @@
 */
 #include "../SDK.hpp"
 #include "platform.hpp"
+#include "region_map.hpp"
 #include <vector>
 #include <algorithm>
+#include <mutex>
 
 // Platform tools for windows. Maybe I'll make linux ones too
 
 #include <Windows.h>
 #include <psapi.h>
 
+namespace
+{
+	auto is_code_region(const MEMORY_BASIC_INFORMATION& info) -> bool
+	{
+		constexpr const DWORD protect_flags = PAGE_EXECUTE | PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY;
+
+		return info.Type
+			&& !(info.Protect & (PAGE_GUARD | PAGE_NOACCESS))
+			&& info.Protect & protect_flags;
+	}
+
+	// Executable regions seen so far. Regions are never dropped: code we look
+	// at (vtable entries) lives in modules that stay loaded as long as we do.
+	std::mutex s_code_regions_mutex;
+	platform::region_map s_code_regions;
+	bool s_code_regions_built = false;
+
+	// Walks the whole address space once, a few thousand regions at most
+	auto build_code_regions() -> void
+	{
+		SYSTEM_INFO system_info;
+		GetSystemInfo(&system_info);
+
+		auto address = std::uintptr_t(system_info.lpMinimumApplicationAddress);
+		const auto max_address = std::uintptr_t(system_info.lpMaximumApplicationAddress);
+
+		std::vector<platform::region_map::region> regions;
+		MEMORY_BASIC_INFORMATION info;
+		while(address < max_address && VirtualQuery(reinterpret_cast<void*>(address), &info, sizeof info))
+		{
+			const auto begin = std::uintptr_t(info.BaseAddress);
+			const auto end = begin + info.RegionSize;
+			if(end <= address)
+				break;
+
+			if(is_code_region(info))
+				regions.push_back({ begin, end });
+
+			address = end;
+		}
+
+		s_code_regions.assign(std::move(regions));
+	}
+}
+
 auto platform::get_export(const char* module_name, const char* export_name) -> void*
 {
 	HMODULE mod;
@@ -83,12 +130,27 @@ auto platform::get_module_info(const char* module_name) -> std::pair<std::uintpt
 
 auto platform::is_code_ptr(void* ptr) -> bool
 {
-	constexpr const DWORD protect_flags = PAGE_EXECUTE | PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY;
+	const auto address = std::uintptr_t(ptr);
+
+	std::lock_guard<std::mutex> lock(s_code_regions_mutex);
+
+	if(!s_code_regions_built)
+	{
+		s_code_regions_built = true;
+		build_code_regions();
+	}
+
+	if(s_code_regions.contains(address))
+		return true;
 
+	// Misses are rare but can be code mapped since the walk, so ask again and
+	// remember the region if it is executable now. Non-code isn't remembered,
+	// the end of every vtable is one of these.
 	MEMORY_BASIC_INFORMATION out;
-	VirtualQuery(ptr, &out, sizeof out);
+	if(!VirtualQuery(ptr, &out, sizeof out) || !is_code_region(out))
+		return false;
 
-	return out.Type
-		&& !(out.Protect & (PAGE_GUARD | PAGE_NOACCESS))
-		&& out.Protect & protect_flags;
+	const auto begin = std::uintptr_t(out.BaseAddress);
+	s_code_regions.insert({ begin, begin + out.RegionSize });
+	return true;
 }
@@ -60,6 +60,8 @@ namespace platform
 	auto get_interface(const char* module_name, const char* interface_name) -> void*;
 	auto get_module_info(const char* module_name) -> std::pair<std::uintptr_t, std::size_t>;
 	//auto find_pattern(const char* module_name, const char* pattern, const char* mask) -> std::uintptr_t;
+	// Looked up in a cached table of executable regions, the OS is only asked
+	// on misses
 	auto is_code_ptr(void* ptr) -> bool;
 	auto get_export(const char* module_name, const char* export_name) -> void*;
 
@@ -0,0 +1,69 @@
+#include "file_watcher.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+auto poll_watcher::watch(const std::string& path, callback on_change) -> void
+{
+	entry e;
+	e.path = path;
+	e.on_change = std::move(on_change);
+
+	std::string contents;
+	refresh(e, contents);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_entries.push_back(std::move(e));
+}
+
+auto poll_watcher::poll() -> void
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	for(auto& e : m_entries)
+	{
+		std::string contents;
+		if(refresh(e, contents))
+			e.on_change(e.path, contents);
+	}
+}
+
+auto poll_watcher::refresh(entry& e, std::string& contents) -> bool
+{
+	std::error_code error;
+	const auto size = std::filesystem::file_size(e.path, error);
+	const auto exists = !error;
+	const auto write_time = exists
+		? std::int64_t(std::filesystem::last_write_time(e.path, error).time_since_epoch().count())
+		: 0;
+
+	if(exists == e.exists && size == e.size && write_time == e.write_time)
+		return false;
+
+	// Deleted, or between a writer's truncate and write. Nothing to load,
+	// the next state it settles in is compared to the last good one.
+	if(!exists || error)
+	{
+		e.exists = false;
+		return false;
+	}
+
+	auto file = std::ifstream(e.path, std::ios::binary);
+	if(!file.good())
+		return false;
+
+	contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	const auto hash = fnv::hash_bytes(contents.data(), contents.size());
+
+	const auto had_contents = e.exists || e.hash;
+	e.exists = true;
+	e.size = size;
+	e.write_time = write_time;
+
+	if(had_contents && hash == e.hash)
+		return false;
+
+	e.hash = hash;
+	return true;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include "fnv_hash.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Reports files whose contents changed. Callbacks get the new contents, so a
+// change isn't read twice. poll_watcher checks on every poll() call; a backend
+// on ReadDirectoryChangesW or inotify only has to implement the same interface
+// and can call back from its own thread instead.
+class file_watcher
+{
+public:
+	using callback = std::function<void(const std::string& path, const std::string& contents)>;
+
+	virtual ~file_watcher() = default;
+
+	// Changes from the file's current state on are reported, including the
+	// file being created. Not called after polling started.
+	virtual auto watch(const std::string& path, callback on_change) -> void = 0;
+
+	// Calls back for each file that changed since the last poll, on the calling thread
+	virtual auto poll() -> void = 0;
+};
+
+// Compares size and modification time, and hashes the contents only when one
+// of them moved, so saving the same bytes again or touching a file isn't a change
+class poll_watcher : public file_watcher
+{
+public:
+	auto watch(const std::string& path, callback on_change) -> void override;
+	auto poll() -> void override;
+
+private:
+	struct entry
+	{
+		std::string path;
+		callback on_change;
+		bool exists = false;
+		std::uintmax_t size = 0;
+		std::int64_t write_time = 0;
+		fnv::hash hash = 0;
+	};
+
+	// Updates the entry, true if the contents changed
+	static auto refresh(entry& e, std::string& contents) -> bool;
+
+	std::mutex m_mutex;
+	std::vector<entry> m_entries;
+};
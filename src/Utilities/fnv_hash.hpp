@@ -24,6 +24,13 @@
 */
 #pragma once
 #include <cstdlib>
+#include <cstdint>
+
+#ifdef _MSC_VER
+#define FNV_FORCEINLINE __forceinline
+#else
+#define FNV_FORCEINLINE inline __attribute__((always_inline))
+#endif
 
 namespace detail
 {
@@ -66,14 +73,15 @@ namespace detail
 
 	public:
 		template <std::size_t N>
-		static __forceinline constexpr auto hash_constexpr(const char(&str)[N], const std::size_t size = N) -> hash
+		static FNV_FORCEINLINE constexpr auto hash_constexpr(const char(&str)[N], const std::size_t size = N) -> hash
 		{
 			return static_cast<hash>(1ull * (size == 1
 				? (k_offset_basis ^ str[0])
 				: (hash_constexpr(str, size - 1) ^ str[size - 1])) * k_prime);
 		}
 
-		static auto __forceinline hash_runtime(const char* str) -> hash
+		// Also usable in constant expressions, for tables of strings known at compile time
+		static FNV_FORCEINLINE constexpr auto hash_runtime(const char* str) -> hash
 		{
 			auto result = k_offset_basis;
 			do
@@ -84,6 +92,20 @@ namespace detail
 
 			return result;
 		}
+
+		// Not compatible with hash_runtime, the terminator isn't hashed
+		static auto hash_bytes(const void* data, const std::size_t size) -> hash
+		{
+			const auto bytes = static_cast<const std::uint8_t*>(data);
+			auto result = k_offset_basis;
+			for(auto i = std::size_t(0); i < size; ++i)
+			{
+				result ^= bytes[i];
+				result *= k_prime;
+			}
+
+			return result;
+		}
 	};
 }
 
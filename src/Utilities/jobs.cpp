@@ -0,0 +1,218 @@
+#include "jobs.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	struct worker_queue
+	{
+		std::mutex mutex;
+		std::deque<std::function<void()>> jobs;
+	};
+
+	class pool
+	{
+	public:
+		explicit pool(const std::size_t workers)
+		{
+			for(auto i = std::size_t(0); i < workers; ++i)
+				m_queues.push_back(std::make_unique<worker_queue>());
+
+			// Workers only read the ids from jobs, which can't be posted before we return
+			for(auto i = std::size_t(0); i < workers; ++i)
+			{
+				m_threads.emplace_back(&pool::worker_loop, this, i);
+				m_worker_ids.push_back(m_threads.back().get_id());
+			}
+		}
+
+		auto post(std::function<void()> job) -> bool
+		{
+			const auto worker = find_worker(std::this_thread::get_id());
+			const auto index = worker < m_queues.size() ? worker : m_next_queue++ % m_queues.size();
+
+			// Under the sleep lock, so a worker between its check and its wait can't
+			// miss it, and shutdown can't clear the queues before it lands
+			{
+				std::lock_guard<std::mutex> lock(m_sleep_mutex);
+				if(m_stopping)
+					return false;
+
+				auto& queue = *m_queues[index];
+				std::lock_guard<std::mutex> queue_lock(queue.mutex);
+				queue.jobs.push_back(std::move(job));
+				++m_pending;
+			}
+
+			m_wake.notify_one();
+			return true;
+		}
+
+		auto shutdown() -> void
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_sleep_mutex);
+				if(m_stopping)
+					return;
+				m_stopping = true;
+			}
+			m_wake.notify_all();
+
+			for(auto& thread : m_threads)
+				if(thread.joinable() && thread.get_id() != std::this_thread::get_id())
+					thread.join();
+
+			for(const auto& queue : m_queues)
+			{
+				std::lock_guard<std::mutex> lock(queue->mutex);
+				m_cancelled += queue->jobs.size();
+				queue->jobs.clear();
+			}
+		}
+
+		auto is_stopping() const -> bool
+		{
+			return m_stopping;
+		}
+
+		auto get_stats() const -> jobs::stats
+		{
+			jobs::stats result;
+			result.workers = m_queues.size();
+			result.executed = m_executed;
+			result.stolen = m_stolen;
+			result.cancelled = m_cancelled;
+			return result;
+		}
+
+	private:
+		// No thread_local: static TLS isn't set up when we're manually mapped.
+		// The size of the pool if the thread isn't one of our workers.
+		auto find_worker(const std::thread::id id) const -> std::size_t
+		{
+			return std::size_t(std::find(m_worker_ids.begin(), m_worker_ids.end(), id) - m_worker_ids.begin());
+		}
+
+		// Own deque from the back, then the others from the front
+		auto take(const std::size_t index, std::function<void()>& job) -> bool
+		{
+			{
+				auto& own = *m_queues[index];
+				std::lock_guard<std::mutex> lock(own.mutex);
+				if(!own.jobs.empty())
+				{
+					job = std::move(own.jobs.back());
+					own.jobs.pop_back();
+					return true;
+				}
+			}
+
+			for(auto i = std::size_t(1); i < m_queues.size(); ++i)
+			{
+				auto& victim = *m_queues[(index + i) % m_queues.size()];
+				std::lock_guard<std::mutex> lock(victim.mutex);
+				if(!victim.jobs.empty())
+				{
+					job = std::move(victim.jobs.front());
+					victim.jobs.pop_front();
+					++m_stolen;
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		auto worker_loop(const std::size_t index) -> void
+		{
+			while(!m_stopping)
+			{
+				std::function<void()> job;
+				if(take(index, job))
+				{
+					--m_pending;
+
+					// submit keeps exceptions in the future, plain posts have nobody to report to
+					try
+					{
+						job();
+					}
+					catch(...)
+					{
+					}
+
+					++m_executed;
+					continue;
+				}
+
+				std::unique_lock<std::mutex> lock(m_sleep_mutex);
+				m_wake.wait(lock, [this] { return m_stopping || m_pending > 0; });
+			}
+		}
+
+		std::vector<std::unique_ptr<worker_queue>> m_queues;
+		std::vector<std::thread> m_threads;
+		std::vector<std::thread::id> m_worker_ids; // Not m_threads, joining clears their ids
+		std::atomic<std::size_t> m_next_queue{ 0 };
+
+		std::mutex m_sleep_mutex;
+		std::condition_variable m_wake;
+		std::atomic<std::size_t> m_pending{ 0 };
+		std::atomic<bool> m_stopping{ false };
+
+		std::atomic<std::size_t> m_executed{ 0 };
+		std::atomic<std::size_t> m_stolen{ 0 };
+		std::atomic<std::size_t> m_cancelled{ 0 };
+	};
+
+	// Never deleted: if we're unloaded without uninitialize, joining threads from
+	// a static destructor under the loader lock would hang the game
+	std::once_flag s_pool_once;
+	pool* s_pool = nullptr;
+
+	auto get_pool() -> pool&
+	{
+		std::call_once(s_pool_once, []
+		{
+			s_pool = new pool(jobs::worker_count());
+		});
+		return *s_pool;
+	}
+}
+
+auto jobs::worker_count() -> std::size_t
+{
+#ifdef NSKINZ_JOB_WORKERS
+	// Fixed by the tests, so stealing gets exercised on any machine
+	return NSKINZ_JOB_WORKERS;
+#else
+	const auto hardware = std::size_t(std::thread::hardware_concurrency());
+	return hardware > 1 ? hardware - 1 : 1;
+#endif
+}
+
+auto jobs::post(std::function<void()> job) -> bool
+{
+	return get_pool().post(std::move(job));
+}
+
+auto jobs::is_stopping() -> bool
+{
+	return get_pool().is_stopping();
+}
+
+auto jobs::shutdown() -> void
+{
+	get_pool().shutdown();
+}
+
+auto jobs::get_stats() -> stats
+{
+	return get_pool().get_stats();
+}
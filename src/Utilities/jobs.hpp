@@ -0,0 +1,50 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <utility>
+
+// Shared pool for background work. Every worker has its own deque: it takes
+// its newest job first and steals the oldest from the others when it runs
+// dry. Jobs posted from a worker go to that worker's deque, jobs from other
+// threads are spread round robin.
+//
+// shutdown() cancels everything still queued, futures of those jobs report
+// std::future_errc::broken_promise. Long jobs should poll is_stopping().
+namespace jobs
+{
+	// Leaves a core for the game's main and render threads
+	auto worker_count() -> std::size_t;
+
+	// False if the pool is shut down and the job was dropped
+	auto post(std::function<void()> job) -> bool;
+
+	template <typename Fn>
+	auto submit(Fn fn) -> std::future<decltype(fn())>
+	{
+		using result = decltype(fn());
+
+		// std::function needs a copyable target, packaged_task isn't
+		auto task = std::make_shared<std::packaged_task<result()>>(std::move(fn));
+		auto future = task->get_future();
+		post([task] { (*task)(); });
+		return future;
+	}
+
+	auto is_stopping() -> bool;
+
+	// Waits for running jobs, drops queued ones and stops the workers. Posting
+	// afterwards fails. Called from uninitialize.
+	auto shutdown() -> void;
+
+	struct stats
+	{
+		std::size_t workers = 0;
+		std::size_t executed = 0;
+		std::size_t stolen = 0;
+		std::size_t cancelled = 0;
+	};
+
+	auto get_stats() -> stats;
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include "jobs.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+
+namespace parallel
+{
+	// Leave a core for the game's main and render threads.
+	inline auto worker_count() -> std::size_t
+	{
+		return jobs::worker_count();
+	}
+
+	// Calls fn(i) for every i in [0, count). Items are handed out one by one
+	// from a shared counter, so uneven items (big and small files) balance out.
+	// The calling thread works too and only waits for items already taken, so
+	// this is safe to call from a job even when every worker is busy. The
+	// first exception fn throws is rethrown here.
+	template <typename Fn>
+	auto for_each_index(const std::size_t count, Fn&& fn) -> void
+	{
+		if(count == 0)
+			return;
+
+		const auto threads = (std::min)(worker_count(), count);
+		if(threads == 1)
+		{
+			for(auto i = std::size_t(0); i < count; ++i)
+				fn(i);
+			return;
+		}
+
+		// Helpers that start after the last item was taken never touch fn, so
+		// they may outlive this call
+		struct shared_state
+		{
+			std::atomic<std::size_t> next{ 0 };
+			std::atomic<std::size_t> done{ 0 };
+			std::mutex mutex;
+			std::condition_variable finished;
+			std::exception_ptr error;
+		};
+
+		const auto state = std::make_shared<shared_state>();
+		const auto work = [state, count, fn = &fn]
+		{
+			for(auto i = state->next++; i < count; i = state->next++)
+			{
+				try
+				{
+					(*fn)(i);
+				}
+				catch(...)
+				{
+					std::lock_guard<std::mutex> lock(state->mutex);
+					if(!state->error)
+						state->error = std::current_exception();
+				}
+
+				if(++state->done == count)
+				{
+					std::lock_guard<std::mutex> lock(state->mutex);
+					state->finished.notify_all();
+				}
+			}
+		};
+
+		for(auto i = std::size_t(1); i < threads; ++i)
+			jobs::post(work);
+
+		work();
+
+		std::unique_lock<std::mutex> lock(state->mutex);
+		state->finished.wait(lock, [&] { return state->done == count; });
+
+		if(state->error)
+			std::rethrow_exception(state->error);
+	}
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+namespace platform
+{
+	// Sorted, non-overlapping set of address ranges with binary search lookup.
+	// Knows nothing about the OS, the platform code fills it.
+	class region_map
+	{
+	public:
+		struct region
+		{
+			std::uintptr_t begin = 0;
+			std::uintptr_t end = 0; // Exclusive
+		};
+
+		// Replaces the contents. Regions may come unsorted, touching or
+		// overlapping, they are merged.
+		auto assign(std::vector<region> regions) -> void
+		{
+			regions.erase(std::remove_if(regions.begin(), regions.end(), [](const region& r)
+			{
+				return r.begin >= r.end;
+			}), regions.end());
+
+			std::sort(regions.begin(), regions.end(), [](const region& a, const region& b)
+			{
+				return a.begin < b.begin;
+			});
+
+			m_regions.clear();
+			for(const auto& r : regions)
+			{
+				if(!m_regions.empty() && r.begin <= m_regions.back().end)
+					m_regions.back().end = (std::max)(m_regions.back().end, r.end);
+				else
+					m_regions.push_back(r);
+			}
+		}
+
+		// Adds one region, merging it with any it touches
+		auto insert(region r) -> void
+		{
+			if(r.begin >= r.end)
+				return;
+
+			// First region that ends at or after our begin, and first that starts after our end
+			auto first = std::lower_bound(m_regions.begin(), m_regions.end(), r.begin, [](const region& a, const std::uintptr_t address)
+			{
+				return a.end < address;
+			});
+			auto last = std::upper_bound(first, m_regions.end(), r.end, [](const std::uintptr_t address, const region& a)
+			{
+				return address < a.begin;
+			});
+
+			if(first != last)
+			{
+				r.begin = (std::min)(r.begin, first->begin);
+				r.end = (std::max)(r.end, std::prev(last)->end);
+				first = m_regions.erase(first, last);
+			}
+
+			m_regions.insert(first, r);
+		}
+
+		auto contains(const std::uintptr_t address) const -> bool
+		{
+			const auto it = std::upper_bound(m_regions.begin(), m_regions.end(), address, [](const std::uintptr_t value, const region& a)
+			{
+				return value < a.begin;
+			});
+
+			return it != m_regions.begin() && address < std::prev(it)->end;
+		}
+
+		auto clear() -> void
+		{
+			m_regions.clear();
+		}
+
+		auto size() const -> std::size_t
+		{
+			return m_regions.size();
+		}
+
+		auto get_regions() const -> const std::vector<region>&
+		{
+			return m_regions;
+		}
+
+	private:
+		std::vector<region> m_regions;
+	};
+}
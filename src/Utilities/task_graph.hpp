@@ -0,0 +1,225 @@
+#pragma once
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <initializer_list>
+#include <mutex>
+#include <vector>
+
+// Steps with declared dependencies. run_parallel starts every step as soon as
+// the steps it depends on are done, run_serial runs them in the order they were
+// added. A step can only depend on steps added before it, so adding them in a
+// working serial order is enough to rule out cycles. A graph runs once.
+//
+// A step that throws skips everything depending on it, directly or not, while
+// the other steps still run. Either run then rethrows the first exception.
+class task_graph
+{
+public:
+	using task_id = std::size_t;
+
+	enum class affinity
+	{
+		any,   // Workers or the calling thread
+		caller // Only the thread calling run, for steps that touch engine state
+	};
+
+	struct run_stats
+	{
+		bool parallel = false;
+		double wall_ms = 0.0;  // Start to finish
+		double task_ms = 0.0;  // Sum of the steps, what a serial run costs
+	};
+
+	auto add(const char* name, const affinity where, std::function<void()> fn,
+		const std::initializer_list<task_id> dependencies = {}) -> task_id
+	{
+		const auto id = m_tasks.size();
+
+		task t;
+		t.name = name;
+		t.where = where;
+		t.fn = std::move(fn);
+		for(const auto dependency : dependencies)
+		{
+			assert(dependency < id);
+			m_tasks[dependency].dependents.push_back(id);
+			++t.pending;
+		}
+
+		m_tasks.push_back(std::move(t));
+		return id;
+	}
+
+	auto run_serial() -> run_stats
+	{
+		const auto start = clock::now();
+
+		for(auto& t : m_tasks)
+			complete(t, run_task(t));
+
+		if(m_error)
+			std::rethrow_exception(m_error);
+
+		return finish(start, false);
+	}
+
+	// Falls back to run_serial when there's only one core to run on
+	auto run_parallel() -> run_stats
+	{
+		auto any_count = std::size_t(0);
+		for(const auto& t : m_tasks)
+			any_count += t.where == affinity::any;
+
+		const auto workers = (std::min)(parallel::worker_count(), any_count);
+		if(workers < 2)
+			return run_serial();
+
+		const auto start = clock::now();
+
+		m_running = true;
+		m_remaining = m_tasks.size();
+		for(auto id = task_id(0); id < m_tasks.size(); ++id)
+			if(!m_tasks[id].pending)
+				queue_for(m_tasks[id].where).push_back(id);
+
+		// Helpers on the shared pool. One that only starts after everything is
+		// done returns right away, the wait just keeps this graph alive for it.
+		std::vector<std::future<void>> helpers;
+		helpers.reserve(workers - 1);
+		for(auto i = std::size_t(1); i < workers; ++i)
+			helpers.push_back(jobs::submit([this] { work(false); }));
+
+		work(true);
+
+		for(auto& helper : helpers)
+			helper.wait();
+
+		if(m_error)
+			std::rethrow_exception(m_error);
+
+		return finish(start, true);
+	}
+
+	// Milliseconds each step took in the last run, in the order added
+	template <typename Fn>
+	auto for_each_timing(Fn fn) const -> void
+	{
+		for(const auto& t : m_tasks)
+			fn(t.name, t.milliseconds);
+	}
+
+private:
+	using clock = std::chrono::steady_clock;
+
+	struct task
+	{
+		const char* name = "";
+		affinity where = affinity::any;
+		std::function<void()> fn;
+		std::vector<task_id> dependents;
+		std::size_t pending = 0;
+		bool skipped = false;  // A dependency threw or was skipped
+		double milliseconds = 0.0;
+	};
+
+	auto queue_for(const affinity where) -> std::deque<task_id>&
+	{
+		return where == affinity::caller ? m_ready_caller : m_ready_any;
+	}
+
+	// False if the step was skipped or threw, the first exception is kept
+	auto run_task(task& t) -> bool
+	{
+		if(t.skipped)
+			return false;
+
+		const auto start = clock::now();
+		try
+		{
+			t.fn();
+		}
+		catch(...)
+		{
+			std::lock_guard<std::mutex> lock(m_error_mutex);
+			if(!m_error)
+				m_error = std::current_exception();
+			return false;
+		}
+
+		t.milliseconds = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+		return true;
+	}
+
+	// Dependents of a failed step are still released, they just skip themselves
+	auto complete(const task& t, const bool succeeded) -> void
+	{
+		for(const auto dependent : t.dependents)
+		{
+			if(!succeeded)
+				m_tasks[dependent].skipped = true;
+			if(!--m_tasks[dependent].pending && m_running)
+				queue_for(m_tasks[dependent].where).push_back(dependent);
+		}
+	}
+
+	auto work(const bool is_caller) -> void
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		for(;;)
+		{
+			m_ready_cv.wait(lock, [&]
+			{
+				return !m_remaining || !m_ready_any.empty() || (is_caller && !m_ready_caller.empty());
+			});
+
+			if(!m_remaining)
+				return;
+
+			// The caller takes its own steps first, nobody else can run them
+			auto& queue = is_caller && !m_ready_caller.empty() ? m_ready_caller : m_ready_any;
+			const auto id = queue.front();
+			queue.pop_front();
+
+			lock.unlock();
+			const auto succeeded = run_task(m_tasks[id]);
+			lock.lock();
+
+			complete(m_tasks[id], succeeded);
+
+			--m_remaining;
+			m_ready_cv.notify_all();
+		}
+	}
+
+	auto finish(const clock::time_point start, const bool parallel) const -> run_stats
+	{
+		run_stats stats;
+		stats.parallel = parallel;
+		stats.wall_ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+		for(const auto& t : m_tasks)
+			stats.task_ms += t.milliseconds;
+		return stats;
+	}
+
+	std::vector<task> m_tasks;
+
+	std::mutex m_mutex;
+	std::condition_variable m_ready_cv;
+	std::deque<task_id> m_ready_any;
+	std::deque<task_id> m_ready_caller;
+	std::size_t m_remaining = 0;
+	bool m_running = false;  // Parallel run, ready steps get queued
+
+	std::mutex m_error_mutex;
+	std::exception_ptr m_error;
+};
@@ -0,0 +1,66 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Per thread state found by thread id, where thread_local can't be used:
+// static TLS isn't set up when we're manually mapped. A thread gets its slot
+// on its first call and keeps it, finding it again doesn't lock. A new thread
+// that reuses a finished thread's id takes over its slot. Only meant for a
+// handful of threads, the lookup is a linear scan.
+template <typename T, std::size_t Capacity>
+class thread_slots
+{
+public:
+	// The calling thread's value, null once every slot is taken
+	auto get() -> T*
+	{
+		const auto id = std::this_thread::get_id();
+		const auto count = m_count.load(std::memory_order_acquire);
+		for(auto i = std::size_t(0); i < count; ++i)
+			if(m_slots[i].owner == id)
+				return m_slots[i].value.get();
+
+		return add(id);
+	}
+
+	// Calls fn(value, index) for every thread that got a slot so far
+	template <typename Fn>
+	auto for_each(Fn fn) -> void
+	{
+		const auto count = m_count.load(std::memory_order_acquire);
+		for(auto i = std::size_t(0); i < count; ++i)
+			fn(*m_slots[i].value, i);
+	}
+
+private:
+	// Only the calling thread can add its own id, so it can't be added twice
+	auto add(const std::thread::id id) -> T*
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		const auto count = m_count.load(std::memory_order_relaxed);
+		if(count == Capacity)
+			return nullptr;
+
+		// Filled before the count publishes it and never written again
+		auto& slot = m_slots[count];
+		slot.owner = id;
+		slot.value = std::make_unique<T>();
+		m_count.store(count + 1, std::memory_order_release);
+		return slot.value.get();
+	}
+
+	struct slot
+	{
+		std::thread::id owner;
+		std::unique_ptr<T> value;
+	};
+
+	std::array<slot, Capacity> m_slots;
+	std::atomic<std::size_t> m_count{ 0 };
+	std::mutex m_mutex;
+};
@@ -24,6 +24,8 @@
 */
 #pragma once
 #include "platform.hpp"
+#include <atomic>
+#include <cstdint>
 #include <cstring>
 #include <cassert>
 
@@ -73,6 +75,11 @@ protected:
 		vtbl = m_new_vmt;
 	}
 
+	auto is_hooked(void* inst) const -> bool
+	{
+		return m_new_vmt && *reinterpret_cast<proc_t**>(inst) == m_new_vmt;
+	}
+
 	auto unhook_instance(void* inst) const -> void
 	{
 		auto& vtbl = *reinterpret_cast<proc_t**>(inst);
@@ -155,9 +162,181 @@ private:
 	void* m_class = nullptr;
 };
 
+// Set of instance pointers with open addressing and linear probing. Keeps
+// the load factor at or below one half.
+class vmt_instance_set
+{
+public:
+	constexpr vmt_instance_set() = default;
+
+	~vmt_instance_set()
+	{
+		delete[] m_slots;
+	}
+
+	vmt_instance_set(const vmt_instance_set&) = delete;
+	vmt_instance_set& operator=(const vmt_instance_set&) = delete;
+
+	auto size() const -> std::size_t
+	{
+		return m_size;
+	}
+
+	// True if one more insert would reallocate
+	auto is_full() const -> bool
+	{
+		return (m_size + 1) * 2 > m_capacity;
+	}
+
+	auto contains(void* inst) const -> bool
+	{
+		return m_size && m_slots[find(inst)] == inst;
+	}
+
+	// False if it was already in the set
+	auto insert(void* inst) -> bool
+	{
+		if(is_full())
+			rehash(m_capacity ? m_capacity * 2 : 16);
+
+		const auto slot = find(inst);
+		if(m_slots[slot] == inst)
+			return false;
+
+		m_slots[slot] = inst;
+		++m_size;
+		return true;
+	}
+
+	auto erase(void* inst) -> bool
+	{
+		if(!contains(inst))
+			return false;
+
+		// Backward shift, so lookups never need tombstones
+		auto hole = find(inst);
+		m_slots[hole] = nullptr;
+		--m_size;
+
+		for(auto i = next(hole); m_slots[i]; i = next(i))
+		{
+			const auto home = bucket(m_slots[i]);
+
+			// Move the entry into the hole unless its home lies cyclically in (hole, i]
+			if(hole <= i ? (home <= hole || home > i) : (home <= hole && home > i))
+			{
+				m_slots[hole] = m_slots[i];
+				m_slots[i] = nullptr;
+				hole = i;
+			}
+		}
+
+		return true;
+	}
+
+	template <typename Fn>
+	auto for_each(Fn fn) const -> void
+	{
+		for(auto i = std::size_t(0); i < m_capacity; ++i)
+			if(m_slots[i])
+				fn(m_slots[i]);
+	}
+
+	template <typename Pred>
+	auto erase_if(Pred pred) -> std::size_t
+	{
+		auto erased = std::size_t(0);
+		if(!m_capacity)
+			return erased;
+
+		for(auto i = std::size_t(0); i < m_capacity; ++i)
+			if(m_slots[i] && pred(m_slots[i]))
+				m_slots[i] = reinterpret_cast<void*>(1);
+
+		// Rebuilding in place is simpler than shifting around a batch of holes
+		rehash(m_capacity, &erased);
+		return erased;
+	}
+
+	auto clear() -> void
+	{
+		for(auto i = std::size_t(0); i < m_capacity; ++i)
+			m_slots[i] = nullptr;
+		m_size = 0;
+	}
+
+private:
+	auto bucket(void* inst) const -> std::size_t
+	{
+		// Objects are at least 8 aligned, the multiply mixes in the higher bits
+		// of the rest so neighbouring allocations don't cluster
+		const auto key = std::uintptr_t(inst) >> 3;
+		return std::size_t((key * 0x9E3779B9u) ^ (key >> 12)) & (m_capacity - 1);
+	}
+
+	auto next(const std::size_t slot) const -> std::size_t
+	{
+		return (slot + 1) & (m_capacity - 1);
+	}
+
+	// The slot holding inst, or the empty slot where it would go
+	auto find(void* inst) const -> std::size_t
+	{
+		auto slot = bucket(inst);
+		while(m_slots[slot] && m_slots[slot] != inst)
+			slot = next(slot);
+		return slot;
+	}
+
+	// Entries equal to 1 are dropped and counted in erased
+	auto rehash(const std::size_t capacity, std::size_t* erased = nullptr) -> void
+	{
+		const auto old_slots = m_slots;
+		const auto old_capacity = m_capacity;
+
+		m_slots = new void*[capacity]();
+		m_capacity = capacity;
+		m_size = 0;
+
+		for(auto i = std::size_t(0); i < old_capacity; ++i)
+		{
+			if(!old_slots[i])
+				continue;
+
+			if(old_slots[i] == reinterpret_cast<void*>(1))
+			{
+				if(erased)
+					++*erased;
+				continue;
+			}
+
+			m_slots[find(old_slots[i])] = old_slots[i];
+			++m_size;
+		}
+
+		delete[] old_slots;
+	}
+
+	void** m_slots = nullptr;
+	std::size_t m_capacity = 0;
+	std::size_t m_size = 0;
+};
+
+// Hooks many instances of one class with a shared table. Hooking an instance
+// that already uses our table is a single compare, so callers can re-apply
+// it on every update. Instances are remembered so they can all be restored
+// before unloading.
 class vmt_multi_hook : vmt_base_hook
 {
 public:
+	struct stats
+	{
+		std::size_t instances_hooked = 0; // Vtable pointers we swapped
+		std::size_t already_hooked = 0;   // Calls that found the instance hooked
+		std::size_t tracked = 0;          // Instances that may still use our table
+		std::size_t calls_forwarded = 0;  // Hooked calls passed on to the original
+	};
+
 	constexpr vmt_multi_hook() = default;
 
   ~vmt_multi_hook()
@@ -174,8 +353,96 @@ public:
 	using vmt_base_hook::apply_hook;
 	using vmt_base_hook::get_original_function;
 	using vmt_base_hook::hook_function;
-	using vmt_base_hook::hook_instance;
-	using vmt_base_hook::unhook_instance;
 	using vmt_base_hook::initialize;
-	using vmt_base_hook::initialize_and_hook_instance;
+	using vmt_base_hook::is_hooked;
+
+	auto hook_instance(void* inst) -> void
+	{
+		if(is_hooked(inst))
+		{
+			++m_already_hooked;
+			return;
+		}
+
+		vmt_base_hook::hook_instance(inst);
+		track(inst);
+	}
+
+	auto unhook_instance(void* inst) -> void
+	{
+		vmt_base_hook::unhook_instance(inst);
+		m_instances.erase(inst);
+	}
+
+	// True if the table was created now and the hooks still have to be applied
+	auto initialize_and_hook_instance(void* inst) -> bool
+	{
+		if(is_hooked(inst))
+		{
+			++m_already_hooked;
+			return false;
+		}
+
+		const auto initialized = vmt_base_hook::initialize_and_hook_instance(inst);
+		track(inst);
+		return initialized;
+	}
+
+	// Restores every instance that still uses our table. Instances freed since
+	// were either reused by another object, whose vtable pointer isn't ours,
+	// or by another one of ours, which is fine to restore. Returns the count.
+	auto unhook_all() -> std::size_t
+	{
+		auto restored = std::size_t(0);
+		m_instances.for_each([&](void* inst)
+		{
+			if(!is_hooked(inst))
+				return;
+
+			vmt_base_hook::unhook_instance(inst);
+			++restored;
+		});
+
+		m_instances.clear();
+		return restored;
+	}
+
+	// For hooked functions to call before forwarding to the original
+	auto count_forward() -> void
+	{
+		m_calls_forwarded.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	auto get_stats() const -> stats
+	{
+		stats result;
+		result.instances_hooked = m_instances_hooked;
+		result.already_hooked = m_already_hooked;
+		result.tracked = m_instances.size();
+		result.calls_forwarded = m_calls_forwarded.load(std::memory_order_relaxed);
+		return result;
+	}
+
+private:
+	auto track(void* inst) -> void
+	{
+		++m_instances_hooked;
+
+		// Before the set grows, forget instances that died and whose memory
+		// no longer points at our table
+		if(m_instances.is_full())
+		{
+			m_instances.erase_if([this](void* tracked)
+			{
+				return !is_hooked(tracked);
+			});
+		}
+
+		m_instances.insert(inst);
+	}
+
+	vmt_instance_set m_instances;
+	std::size_t m_instances_hooked = 0;
+	std::size_t m_already_hooked = 0;
+	std::atomic<std::size_t> m_calls_forwarded{ 0 };
 };
\ No newline at end of file
@@ -24,14 +24,47 @@
 */
 #include "config.hpp"
 #include "SDK.hpp"
+#include "frame_scheduler.hpp"
+#include "Hooks/hooks.hpp"
+#include "Utilities/jobs.hpp"
 
+#include <cstring>
 #include <fstream>
+#include <future>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
 #include <nlohmann/json.hpp>
 
 config g_config;
 
 using json = nlohmann::json;
 
+namespace
+{
+	std::mutex s_save_mutex;
+	unsigned s_save_sequence = 0;
+	std::future<void> s_pending_save;
+
+	// Saves can finish out of order on different workers, an older one never
+	// overwrites a newer one
+	std::mutex s_write_mutex;
+	unsigned s_written_sequence = 0;
+
+	auto write_config(const std::string& text, const unsigned sequence) -> void
+	{
+		std::lock_guard<std::mutex> lock(s_write_mutex);
+		if(sequence < s_written_sequence)
+			return;
+
+		auto of = std::ofstream("nSkinz.json");
+		if(of.good())
+			of << text;
+
+		s_written_sequence = sequence;
+	}
+}
+
 #define TO_JSON_HELPER(var_name) {#var_name, o.var_name}
 #define FROM_JSON_HELPER(var_name) {const auto it = j.find(#var_name); if(it != std::end(j)) o.var_name = it->get<decltype(o.var_name)>();}
 #define FROM_JSON_HELPER_STR(var_name) {const auto it = j.find(#var_name); if(it != std::end(j)) strcpy_s(o.var_name, it->get<std::string>().c_str());}
@@ -100,17 +133,63 @@ auto from_json(const json& j, item_setting& o) -> void
 	o.update<sync_type::VALUE_TO_KEY>();
 }
 
+auto to_json(json& j, const config::profile& o) -> void
+{
+	j = json
+	{
+		TO_JSON_HELPER(name),
+		TO_JSON_HELPER(items),
+	};
+}
+
+auto from_json(const json& j, config::profile& o) -> void
+{
+	FROM_JSON_HELPER_STR(name);
+	FROM_JSON_HELPER(items);
+}
+
 auto config::save() -> void
 {
-	auto of = std::ofstream("nSkinz.json");
-	if(of.good())
+	json j;
 	{
-		json j;
-		j["items"] = m_items;
+		const auto config_lock = this->lock();
+		// Older builds only read the items
+		j["items"] = get_items();
+		j["profiles"] = json::array();
+		for(const auto& p : m_profiles)
+			j["profiles"].push_back(*p);
+		j["active_profile"] = get_active_profile();
 		j["misc"]["hitmarker"] = misc.hitmarker;
 		j["misc"]["hitsound"] = misc.hitsound;
-		of << j;
 	}
+	auto text = j.dump();
+
+	std::lock_guard<std::mutex> lock(s_save_mutex);
+	const auto sequence = ++s_save_sequence;
+
+	// Unloading, the pool won't take it
+	if(jobs::is_stopping())
+	{
+		write_config(text, sequence);
+		return;
+	}
+
+	s_pending_save = jobs::submit([text = std::move(text), sequence]
+	{
+		write_config(text, sequence);
+	});
+}
+
+auto config::wait_for_save() -> void
+{
+	std::future<void> pending;
+	{
+		std::lock_guard<std::mutex> lock(s_save_mutex);
+		pending = std::move(s_pending_save);
+	}
+
+	if(pending.valid())
+		pending.wait();
 }
 
 auto config::load() -> void
@@ -120,19 +199,13 @@ auto config::load() -> void
 		auto ifile = std::ifstream("nSkinz.json");
 		if(ifile.good())
 		{
-			auto j = json::parse(ifile);
-			if (j.is_array())
-			{
-				m_items = j.get<std::vector<item_setting>>();
-			}
-			else if (j.is_object())
-			{
-				m_items = j.value("items", std::vector<item_setting>());
-				auto m = j.value("misc", json::object());
-				misc.hitmarker = m.value("hitmarker", false);
-				misc.hitsound = m.value("hitsound", false);
-			}
-			(*g_client_state)->ForceFullUpdate();
+			auto contents = parse(std::string(std::istreambuf_iterator<char>(ifile), std::istreambuf_iterator<char>()));
+			const auto config_lock = lock();
+			set_profiles(std::move(contents.profiles), contents.active_profile);
+			if(contents.has_misc)
+				misc = contents.misc;
+			mark_changed();
+			refresh();
 		}
 	}
 	catch(const std::exception&)
@@ -142,12 +215,351 @@ auto config::load() -> void
 	}
 }
 
+auto config::parse(const std::string& text) -> file_contents
+{
+	file_contents contents;
+
+	const auto single_profile = [&contents](std::vector<item_setting> items)
+	{
+		contents.profiles.resize(1);
+		contents.profiles.front().items = std::move(items);
+	};
+
+	auto j = json::parse(text);
+	if(j.is_array())
+	{
+		single_profile(j.get<std::vector<item_setting>>());
+	}
+	else if(j.is_object())
+	{
+		const auto profiles_it = j.find("profiles");
+		if(profiles_it != std::end(j) && profiles_it->is_array() && !profiles_it->empty())
+		{
+			contents.profiles = profiles_it->get<std::vector<profile>>();
+			contents.active_profile = (std::min)(j.value("active_profile", std::size_t(0)), contents.profiles.size() - 1);
+		}
+		else
+			single_profile(j.value("items", std::vector<item_setting>()));
+
+		auto m = j.value("misc", json::object());
+		contents.has_misc = true;
+		contents.misc.hitmarker = m.value("hitmarker", false);
+		contents.misc.hitsound = m.value("hitsound", false);
+	}
+	else
+		throw std::runtime_error("the config root must be an array or an object");
+
+	// The menu always has an item selected
+	for(auto& p : contents.profiles)
+		if(p.items.empty())
+			p.items.push_back(item_setting());
+
+	return contents;
+}
+
+namespace
+{
+	// First enabled item for the definition, the one get_by_definition_index returns
+	auto find_enabled(const std::vector<item_setting>& items, const int definition_index) -> const item_setting*
+	{
+		for(const auto& item : items)
+			if(item.enabled && item.definition_index == definition_index)
+				return &item;
+		return nullptr;
+	}
+
+	// Only what apply_config_on_attributable_item and the sticker hooks read
+	auto applies_same(const item_setting& left, const item_setting& right) -> bool
+	{
+		if(left.entity_quality_index != right.entity_quality_index
+			|| left.paint_kit_index != right.paint_kit_index
+			|| left.definition_override_index != right.definition_override_index
+			|| left.seed != right.seed
+			|| left.stat_trak != right.stat_trak
+			|| left.wear != right.wear
+			|| strcmp(left.custom_name, right.custom_name) != 0)
+			return false;
+
+		for(auto i = std::size_t(0); i < left.stickers.size(); ++i)
+		{
+			const auto& a = left.stickers[i];
+			const auto& b = right.stickers[i];
+			if(a.kit != b.kit || a.wear != b.wear || a.scale != b.scale || a.rotation != b.rotation)
+				return false;
+		}
+
+		return true;
+	}
+
+	// What the weapon's custom materials are built from, they aren't rebuilt
+	// for a live entity
+	auto paints_same(const item_setting& left, const item_setting& right) -> bool
+	{
+		if(left.paint_kit_index != right.paint_kit_index
+			|| left.definition_override_index != right.definition_override_index
+			|| left.seed != right.seed
+			|| left.wear != right.wear)
+			return false;
+
+		for(auto i = std::size_t(0); i < left.stickers.size(); ++i)
+		{
+			const auto& a = left.stickers[i];
+			const auto& b = right.stickers[i];
+			if(a.kit != b.kit || a.wear != b.wear || a.scale != b.scale || a.rotation != b.rotation)
+				return false;
+		}
+
+		return true;
+	}
+
+	// Set before and cleared now, the entity keeps our value until the server sends its own
+	auto is_cleared(const item_setting& old_item, const item_setting* new_item) -> bool
+	{
+		if(!new_item)
+			return true;
+
+		return (old_item.definition_override_index && !new_item->definition_override_index)
+			|| (old_item.entity_quality_index && !new_item->entity_quality_index)
+			|| (old_item.paint_kit_index && !new_item->paint_kit_index)
+			|| (old_item.seed && !new_item->seed)
+			|| (old_item.stat_trak && !new_item->stat_trak)
+			|| (old_item.custom_name[0] && !new_item->custom_name[0]);
+	}
+}
+
+auto config::diff_items(const std::vector<item_setting>& old_items, const std::vector<item_setting>& new_items) -> item_diff
+{
+	item_diff diff;
+
+	const auto check = [&](const int definition_index)
+	{
+		if(std::find(diff.definitions.begin(), diff.definitions.end(), definition_index) != diff.definitions.end())
+			return;
+
+		const auto old_item = find_enabled(old_items, definition_index);
+		const auto new_item = find_enabled(new_items, definition_index);
+		if(!old_item && !new_item)
+			return;
+
+		if(old_item && new_item && applies_same(*old_item, *new_item))
+			return;
+
+		diff.definitions.push_back(definition_index);
+		if(old_item && is_cleared(*old_item, new_item))
+			diff.needs_full_update = true;
+		else if(new_item && !paints_same(old_item ? *old_item : item_setting(), *new_item))
+			diff.needs_full_update = true;
+	};
+
+	for(const auto& item : old_items)
+		check(item.definition_index);
+	for(const auto& item : new_items)
+		check(item.definition_index);
+
+	return diff;
+}
+
+auto config::apply_changes(file_contents contents) -> bool
+{
+	auto changed = contents.has_misc
+		&& (contents.misc.hitmarker != misc.hitmarker || contents.misc.hitsound != misc.hitsound);
+	if(contents.has_misc)
+		misc = contents.misc;
+
+	// Names and disabled items count too, the menu shows them
+	const auto same_item = [](const item_setting& left, const item_setting& right)
+	{
+		return left.enabled == right.enabled
+			&& left.definition_index == right.definition_index
+			&& strcmp(left.name, right.name) == 0
+			&& applies_same(left, right);
+	};
+
+	const auto same_items = [&same_item](const std::vector<item_setting>& left, const std::vector<item_setting>& right)
+	{
+		return left.size() == right.size() && std::equal(left.begin(), left.end(), right.begin(), same_item);
+	};
+
+	const auto same_profiles = contents.profiles.size() == m_profiles.size()
+		&& std::equal(m_profiles.begin(), m_profiles.end(), contents.profiles.begin(), [](const std::unique_ptr<profile>& left, const profile& right)
+		{
+			return strcmp(left->name, right.name) == 0;
+		});
+
+	// Only the active profile's items need a refresh
+	auto active_changed = false;
+
+	if(same_profiles)
+	{
+		// The caller holds the lock, so the menu isn't looking. assign keeps the
+		// reserved capacity the menu's own edits rely on.
+		for(auto i = std::size_t(0); i < m_profiles.size(); ++i)
+		{
+			auto& items = m_profiles[i]->items;
+			const auto& loaded = contents.profiles[i].items;
+			if(same_items(items, loaded))
+				continue;
+
+			items.assign(loaded.begin(), loaded.end());
+			changed = true;
+			active_changed |= m_profiles[i].get() == m_active.load();
+		}
+
+		const auto active = m_profiles[contents.active_profile].get();
+		if(m_active.exchange(active) != active)
+			changed = active_changed = true;
+	}
+	else
+	{
+		set_profiles(std::move(contents.profiles), contents.active_profile);
+		changed = active_changed = true;
+	}
+
+	if(active_changed)
+	{
+		mark_changed();
+		refresh();
+	}
+
+	return changed;
+}
+
+auto config::get_active_profile() const -> std::size_t
+{
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+	const auto active = m_active.load();
+	const auto it = std::find_if(m_profiles.begin(), m_profiles.end(), [active](const std::unique_ptr<profile>& p)
+	{
+		return p.get() == active;
+	});
+
+	return it == m_profiles.end() ? 0 : std::size_t(it - m_profiles.begin());
+}
+
+auto config::activate_profile(const std::size_t index) -> void
+{
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+	const auto target = m_profiles.at(index).get();
+	if(m_active.exchange(target) == target)
+		return;
+
+	mark_changed();
+	refresh();
+}
+
+auto config::add_profile(const char* name) -> std::size_t
+{
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+	auto& p = add_profile_internal(name);
+	p.items = get_items();
+	return m_profiles.size() - 1;
+}
+
+auto config::remove_profile(const std::size_t index) -> void
+{
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+	if(m_profiles.size() < 2 || index >= m_profiles.size())
+		return;
+
+	if(m_profiles[index].get() == m_active.load())
+		activate_profile(index + 1 < m_profiles.size() ? index + 1 : index - 1);
+
+	retire_profile(std::move(m_profiles[index]));
+	m_profiles.erase(m_profiles.begin() + index);
+}
+
+auto config::add_profile_internal(const char* name) -> profile&
+{
+	auto p = std::make_unique<profile>();
+	strcpy_s(p->name, name);
+
+	// Ghetto fix for possible race conditions
+	p->items.reserve(128);
+
+	m_profiles.push_back(std::move(p));
+	return *m_profiles.back();
+}
+
+auto config::set_profiles(std::vector<profile> profiles, const std::size_t active) -> void
+{
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
+	std::vector<std::unique_ptr<profile>> boxed;
+	for(auto& parsed : profiles)
+	{
+		auto p = std::make_unique<profile>(std::move(parsed));
+		p->items.reserve(128);
+		boxed.push_back(std::move(p));
+	}
+
+	m_active = boxed.at(active).get();
+	m_profiles.swap(boxed);
+
+	for(auto& p : boxed)
+		retire_profile(std::move(p));
+}
+
+auto config::retire_profile(std::unique_ptr<profile> p) -> void
+{
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+	m_retired_profiles.push_back(std::move(p));
+
+	if(m_release_posted)
+		return;
+
+	// Posted for the next frame, so whatever the game thread loaded before the
+	// swap is done with by the time it runs
+	m_release_posted = true;
+	frame_scheduler::post_next_frame(frame_scheduler::priority::low, "release profiles", [this]
+	{
+		return release_retired_profiles();
+	});
+}
+
+auto config::release_retired_profiles() -> bool
+{
+	const auto config_lock = try_lock();
+	if(!config_lock.owns_lock())
+	{
+		frame_scheduler::post_next_frame(frame_scheduler::priority::low, "release profiles", [this]
+		{
+			return release_retired_profiles();
+		});
+		return true;
+	}
+
+	m_retired_profiles.clear();
+	m_release_posted = false;
+	return true;
+}
+
+auto config::refresh() -> void
+{
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+	const auto& items = get_items();
+	auto diff = diff_items(m_refreshed_items, items);
+	m_refreshed_items = items;
+
+	if(diff.definitions.empty())
+		return;
+
+	frame_scheduler::post(frame_scheduler::priority::low, "refresh items", [diff = std::move(diff)]
+	{
+		if(diff.needs_full_update)
+			(*g_client_state)->ForceFullUpdate();
+		else
+			hooks::refresh_items(diff.definitions);
+		return true;
+	});
+}
+
 auto config::get_by_definition_index(const int definition_index) -> item_setting*
 {
-	auto it = std::find_if(m_items.begin(), m_items.end(), [definition_index](const item_setting& e)
+	auto& items = get_items();
+	auto it = std::find_if(items.begin(), items.end(), [definition_index](const item_setting& e)
 	{
 		return e.enabled && e.definition_index == definition_index;
 	});
 
-	return it == m_items.end() ? nullptr : &*it;
+	return it == items.end() ? nullptr : &*it;
 }
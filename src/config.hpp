@@ -26,9 +26,13 @@
 #include "item_definitions.hpp"
 #include "kit_parser.hpp"
 
-#include <unordered_map>
 #include <array>
+#include <vector>
 #include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
 
 template<typename Container, typename T1, typename T2, typename TC>
 class value_syncer
@@ -168,36 +172,169 @@ struct item_setting
 	std::array<sticker_setting, 5> stickers;
 };
 
+// Kill feed icon replacements, keyed by the hash of the icon the server sent.
+// Sorted by hash; never changed once published.
+struct icon_override_table
+{
+	struct entry
+	{
+		fnv::hash original;
+		const char* replacement;
+	};
+
+	std::vector<entry> entries;
+
+	// Last set wins, like assigning into a map
+	auto set(const fnv::hash original, const char* replacement) -> void
+	{
+		for(auto& e : entries)
+			if(e.original == original)
+			{
+				e.replacement = replacement;
+				return;
+			}
+
+		entries.push_back({ original, replacement });
+	}
+
+	auto sort() -> void
+	{
+		std::sort(entries.begin(), entries.end(), [](const entry& left, const entry& right)
+		{
+			return left.original < right.original;
+		});
+	}
+
+	auto find(const fnv::hash original) const -> const char*
+	{
+		const auto it = std::lower_bound(entries.begin(), entries.end(), original, [](const entry& e, const fnv::hash h)
+		{
+			return e.original < h;
+		});
+
+		return it != entries.end() && it->original == original ? it->replacement : nullptr;
+	}
+};
+
 class config
 {
 public:
-	config()
+	// A named loadout. Every profile in the file is parsed and resolved on
+	// load, switching only changes which one the appliers read.
+	struct profile
 	{
-		// Ghetto fix for possible race conditions
-		m_items.reserve(128);
+		char name[32] = "Default";
+		std::vector<item_setting> items;
+	};
 
+	config()
+	{
 		// Default config
-		m_items.push_back(item_setting());
+		auto& items = add_profile_internal("Default").items;
+		items.push_back(item_setting());
+		m_active = m_profiles.front().get();
+		m_refreshed_items = items;
 	}
 
+	// Held by the menu while it shows or edits the profiles and items, and by
+	// whatever replaces them. The game thread only try_locks, it never waits on
+	// the menu.
+	auto lock() -> std::unique_lock<std::recursive_mutex>
+	{
+		return std::unique_lock<std::recursive_mutex>(m_mutex);
+	}
+
+	auto try_lock() -> std::unique_lock<std::recursive_mutex>
+	{
+		return std::unique_lock<std::recursive_mutex>(m_mutex, std::try_to_lock);
+	}
+
+	// Serializes on the calling thread and writes the file on a pool job
 	auto save() -> void;
 	auto load() -> void;
 
+	// Blocks until the last save is on disk, before the pool shuts down
+	auto wait_for_save() -> void;
+
+	// Definition indices whose entities show something else under the new
+	// items. A full update is needed when a value we wrote has to be taken
+	// back: fallbacks are only written when set, and an override replaces the
+	// definition index the server sent. It is also needed when the paint,
+	// stickers or model change, because the weapon builds its custom materials
+	// only once.
+	struct item_diff
+	{
+		std::vector<int> definitions;
+		bool needs_full_update = false;
+	};
+
+	static auto diff_items(const std::vector<item_setting>& old_items, const std::vector<item_setting>& new_items) -> item_diff;
+
+	// Diffs the items against the last refresh and queues the cheapest
+	// refresh that shows the changes on the game thread
+	auto refresh() -> void;
+
 	auto get_by_definition_index(int definition_index) -> item_setting*;
 
+	// The active profile's items
 	auto get_items() -> std::vector<item_setting>&
 	{
-		return m_items;
+		return m_active.load()->items;
 	}
 
-	auto get_icon_override_map() -> std::unordered_map<std::string_view, std::string_view>&
+	// The profile methods lock themselves, references they hand out are only
+	// safe while lock() is held
+	auto get_profile_count() const -> std::size_t
 	{
-		return m_icon_overrides;
+		std::lock_guard<std::recursive_mutex> lock(m_mutex);
+		return m_profiles.size();
 	}
 
-	auto get_icon_override(const std::string_view original) const -> const char*
+	auto get_profile(const std::size_t index) -> profile&
 	{
-		return m_icon_overrides.count(original) ? m_icon_overrides.at(original).data() : nullptr;
+		std::lock_guard<std::recursive_mutex> lock(m_mutex);
+		return *m_profiles.at(index);
+	}
+
+	auto get_active_profile() const -> std::size_t;
+
+	// Swaps the active profile pointer and refreshes only the weapons whose
+	// settings differ between the two
+	auto activate_profile(std::size_t index) -> void;
+
+	// A copy of the active profile's items under a new name, not activated
+	auto add_profile(const char* name) -> std::size_t;
+
+	// The last profile stays, removing the active one activates its neighbour
+	auto remove_profile(std::size_t index) -> void;
+
+	// Replaces the table in one store, readers keep whichever one they loaded
+	auto set_icon_overrides(std::shared_ptr<const icon_override_table> table) -> void
+	{
+		std::atomic_store(&m_icon_overrides, std::move(table));
+	}
+
+	auto get_icon_overrides() const -> std::shared_ptr<const icon_override_table>
+	{
+		return std::atomic_load(&m_icon_overrides);
+	}
+
+	// Hashes the icon once, null without an override
+	auto get_icon_override(const char* original) const -> const char*
+	{
+		const auto table = get_icon_overrides();
+		return table ? table->find(fnv::hash_runtime(original)) : nullptr;
+	}
+
+	// Bumped whenever the items change, so appliers can tell a stale result apart
+	auto get_generation() const -> unsigned
+	{
+		return m_generation;
+	}
+
+	auto mark_changed() -> void
+	{
+		++m_generation;
 	}
 
 	struct misc_settings 
@@ -206,9 +343,43 @@ public:
 		bool hitsound = false;
 	} misc;
 
+	// nSkinz.json as read from disk. The old formats are a bare item array,
+	// without misc, and an object with a single item list; both load as one
+	// profile.
+	struct file_contents
+	{
+		std::vector<profile> profiles;
+		std::size_t active_profile = 0;
+		bool has_misc = false;
+		misc_settings misc;
+	};
+
+	// Throws if the file is malformed. Any thread, once the kits are loaded.
+	static auto parse(const std::string& text) -> file_contents;
+
+	// Takes over what differs from the live config and refreshes only those
+	// items. False if nothing did, e.g. when it's our own save. Call with
+	// lock() held.
+	auto apply_changes(file_contents contents) -> bool;
+
 private:
-	std::vector<item_setting> m_items;
-	std::unordered_map<std::string_view, std::string_view> m_icon_overrides;
+	auto add_profile_internal(const char* name) -> profile&;
+	auto set_profiles(std::vector<profile> profiles, std::size_t active) -> void;
+
+	// Game thread readers may have loaded a retired profile before the swap, it
+	// is freed once the game thread has started another frame
+	auto retire_profile(std::unique_ptr<profile> p) -> void;
+	auto release_retired_profiles() -> bool;
+
+	// Boxed so the item vectors stay put while profiles are added or removed
+	std::vector<std::unique_ptr<profile>> m_profiles;
+	std::atomic<profile*> m_active{ nullptr };
+	std::vector<std::unique_ptr<profile>> m_retired_profiles;
+	bool m_release_posted = false;
+	std::vector<item_setting> m_refreshed_items;
+	std::shared_ptr<const icon_override_table> m_icon_overrides;
+	std::atomic<unsigned> m_generation{ 0 };
+	mutable std::recursive_mutex m_mutex;
 };
 
 extern config g_config;
\ No newline at end of file
@@ -0,0 +1,343 @@
+#include "file_indexer.hpp"
+#include "Utilities/jobs.hpp"
+#include "Utilities/parallel.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+namespace fs = std::filesystem;
+
+namespace
+{
+	constexpr int k_index_version = 1;
+
+	auto to_ticks(const fs::file_time_type time) -> std::int64_t
+	{
+		return std::int64_t(time.time_since_epoch().count());
+	}
+}
+
+file_indexer::indexer::indexer(std::vector<std::string> extensions, std::string prefix, std::string index_file)
+	: m_extensions(std::move(extensions))
+	, m_prefix(std::move(prefix))
+	, m_index_file(std::move(index_file))
+	, m_files(std::make_shared<const file_list>())
+{
+}
+
+file_indexer::indexer::~indexer()
+{
+	shutdown();
+}
+
+auto file_indexer::indexer::has_extension(const std::string& name) const -> bool
+{
+	const auto dot = name.find_last_of('.');
+	if(dot == std::string::npos || dot == 0)
+		return false;
+
+	auto extension = name.substr(dot);
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](const unsigned char c)
+	{
+		return char(std::tolower(c));
+	});
+
+	return std::find(m_extensions.begin(), m_extensions.end(), extension) != m_extensions.end();
+}
+
+// Returns true if the directory had to be listed
+auto file_indexer::indexer::visit_directory(const std::string& root, const std::string& key, directory_entry& out) const -> bool
+{
+	const auto path = fs::path(root) / fs::path(key);
+
+	std::error_code error;
+	const auto mtime = to_ticks(fs::last_write_time(path, error));
+	if(error)
+		return false;
+
+	// Reading the old index from several workers is fine, scan() only replaces it afterwards
+	const auto it = m_directories.find(key);
+	if(it != m_directories.end() && it->second.mtime == mtime)
+	{
+		out = it->second;
+		return false;
+	}
+
+	out.mtime = mtime;
+
+	auto iterator = fs::directory_iterator(path, fs::directory_options::skip_permission_denied, error);
+	for(; !error && iterator != fs::directory_iterator(); iterator.increment(error))
+	{
+		const auto& entry = *iterator;
+		const auto name = entry.path().filename().string();
+
+		// Junctions and symlinks were skipped by the old FindFirstFile walk as well
+		std::error_code status_error;
+		if(entry.is_symlink(status_error))
+			continue;
+
+		if(entry.is_directory(status_error))
+			out.subdirectories.push_back(name);
+		else if(has_extension(name))
+		{
+			file_entry file;
+			file.name = name;
+			file.size = std::uint64_t(entry.file_size(status_error));
+			file.mtime = to_ticks(entry.last_write_time(status_error));
+			out.files.push_back(std::move(file));
+		}
+	}
+
+	return true;
+}
+
+auto file_indexer::indexer::scan(const std::string& root) -> scan_stats
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	std::lock_guard<std::mutex> lock(m_scan_mutex);
+
+	if(m_root != root)
+	{
+		m_root = root;
+		m_directories.clear();
+		m_index_loaded = false;
+	}
+
+	if(!m_index_loaded)
+	{
+		m_index_loaded = true;
+		load_index();
+	}
+
+	scan_stats stats;
+	directory_map directories;
+
+	std::error_code error;
+	stats.root_found = fs::is_directory(fs::path(root), error);
+
+	// Breadth first, one level at a time, with every directory of a level in parallel
+	std::vector<std::string> level;
+	if(stats.root_found)
+		level.emplace_back();
+
+	while(!level.empty() && !m_shutdown)
+	{
+		std::vector<directory_entry> entries(level.size());
+		std::vector<char> rescanned(level.size());
+
+		parallel::for_each_index(level.size(), [&](const std::size_t i)
+		{
+			rescanned[i] = visit_directory(root, level[i], entries[i]);
+		});
+
+		std::vector<std::string> next_level;
+		for(auto i = std::size_t(0); i < level.size(); ++i)
+		{
+			++stats.directories;
+			stats.rescanned += rescanned[i];
+			stats.files += int(entries[i].files.size());
+
+			for(const auto& subdirectory : entries[i].subdirectories)
+				next_level.push_back(level[i] + subdirectory + "/");
+
+			directories.emplace(std::move(level[i]), std::move(entries[i]));
+		}
+
+		level = std::move(next_level);
+	}
+
+	if(m_shutdown)
+		return stats;
+
+	m_directories = std::move(directories);
+
+	auto files = std::make_shared<file_list>();
+	files->reserve(std::size_t(stats.files));
+	for(const auto& directory : m_directories)
+		for(const auto& file : directory.second.files)
+			files->push_back(m_prefix + directory.first + file.name);
+
+	std::sort(files->begin(), files->end());
+	files->erase(std::unique(files->begin(), files->end()), files->end());
+
+	if(stats.rescanned > 0 || !stats.root_found)
+		save_index();
+
+	stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	{
+		std::lock_guard<std::mutex> published_lock(m_published_mutex);
+		m_files = std::move(files);
+		m_last_stats = stats;
+	}
+	m_ready = true;
+
+	return stats;
+}
+
+auto file_indexer::indexer::load_index() -> void
+{
+	try
+	{
+		auto file = std::ifstream(m_index_file);
+		if(!file.good())
+			return;
+
+		json j;
+		file >> j;
+
+		if(j.value("version", 0) != k_index_version || j.value("root", std::string()) != m_root)
+			return;
+
+		for(const auto& it : j.at("directories").items())
+		{
+			directory_entry directory;
+			directory.mtime = it.value().at("mtime").get<std::int64_t>();
+
+			for(const auto& file_json : it.value().at("files"))
+			{
+				file_entry file;
+				file.name = file_json.at(0).get<std::string>();
+				file.size = file_json.at(1).get<std::uint64_t>();
+				file.mtime = file_json.at(2).get<std::int64_t>();
+				directory.files.push_back(std::move(file));
+			}
+
+			directory.subdirectories = it.value().at("subdirectories").get<std::vector<std::string>>();
+
+			m_directories.emplace(it.key(), std::move(directory));
+		}
+	}
+	catch(const std::exception&)
+	{
+		// The index is only a cache, a full scan rebuilds it
+		m_directories.clear();
+	}
+}
+
+auto file_indexer::indexer::save_index() const -> void
+{
+	try
+	{
+		json directories = json::object();
+		for(const auto& directory : m_directories)
+		{
+			json files = json::array();
+			for(const auto& file : directory.second.files)
+				files.push_back({ file.name, file.size, file.mtime });
+
+			directories[directory.first] = {
+				{ "mtime", directory.second.mtime },
+				{ "files", std::move(files) },
+				{ "subdirectories", directory.second.subdirectories }
+			};
+		}
+
+		const json j = {
+			{ "version", k_index_version },
+			{ "root", m_root },
+			{ "directories", std::move(directories) }
+		};
+
+		// Write beside and swap in, so a crash never leaves half an index behind
+		const auto temp_file = m_index_file + ".tmp";
+		{
+			auto of = std::ofstream(temp_file);
+			of << j.dump();
+			if(!of.good())
+				return;
+		}
+
+		std::error_code error;
+		fs::rename(temp_file, m_index_file, error);
+	}
+	catch(const std::exception&)
+	{
+	}
+}
+
+auto file_indexer::indexer::worker_loop() -> void
+{
+	for(;;)
+	{
+		std::string root;
+		callback on_done;
+		{
+			std::lock_guard<std::mutex> lock(m_worker_mutex);
+			if(!m_has_pending || m_shutdown)
+			{
+				m_worker_running = false;
+				return;
+			}
+
+			root = std::move(m_pending_root);
+			on_done = std::move(m_pending_callback);
+			m_has_pending = false;
+		}
+
+		const auto stats = scan(root);
+
+		if(on_done && !m_shutdown)
+			on_done(stats);
+	}
+}
+
+auto file_indexer::indexer::scan_async(std::string root, callback on_done) -> void
+{
+	std::lock_guard<std::mutex> lock(m_worker_mutex);
+
+	if(m_shutdown)
+		return;
+
+	m_pending_root = std::move(root);
+	m_pending_callback = std::move(on_done);
+	m_has_pending = true;
+
+	if(m_worker_running)
+		return;
+
+	if(m_worker.valid())
+		m_worker.wait();
+
+	m_worker_running = true;
+	m_worker = jobs::submit([this] { worker_loop(); });
+}
+
+auto file_indexer::indexer::is_running() const -> bool
+{
+	std::lock_guard<std::mutex> lock(m_worker_mutex);
+	return m_worker_running;
+}
+
+auto file_indexer::indexer::get_files() const -> std::shared_ptr<const file_list>
+{
+	std::lock_guard<std::mutex> lock(m_published_mutex);
+	return m_files;
+}
+
+auto file_indexer::indexer::get_last_stats() const -> scan_stats
+{
+	std::lock_guard<std::mutex> lock(m_published_mutex);
+	return m_last_stats;
+}
+
+auto file_indexer::indexer::shutdown() -> void
+{
+	m_shutdown = true;
+
+	std::future<void> worker;
+	{
+		std::lock_guard<std::mutex> lock(m_worker_mutex);
+		worker = std::move(m_worker);
+	}
+
+	// Also returns if the pool cancelled the job before it started
+	if(worker.valid())
+		worker.wait();
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Incremental index of the files below a directory. A directory whose mtime is
+// unchanged since the last scan is taken from the index instead of being listed
+// again, so a rescan only stats the directories themselves. The index is saved
+// as JSON, which keeps the first scan after a restart incremental too.
+//
+// Directory mtimes change when entries are added, removed or renamed, not when
+// a file is rewritten in place, so the size and mtime kept per file can be stale
+// for unchanged directories. Consumers that care (model_validator) stat again.
+namespace file_indexer
+{
+	struct file_entry
+	{
+		std::string name;
+		std::uint64_t size = 0;
+		std::int64_t mtime = 0;
+	};
+
+	struct directory_entry
+	{
+		std::int64_t mtime = 0;
+		std::vector<file_entry> files;
+		std::vector<std::string> subdirectories;
+	};
+
+	// Keys are paths relative to the root: "" for the root, "a/b/" below it
+	using directory_map = std::unordered_map<std::string, directory_entry>;
+
+	using file_list = std::vector<std::string>;
+
+	struct scan_stats
+	{
+		bool root_found = false;
+		int directories = 0;
+		int rescanned = 0;
+		int files = 0;
+		double milliseconds = 0.0;
+	};
+
+	class indexer
+	{
+	public:
+		using callback = std::function<void(const scan_stats&)>;
+
+		// Files with one of the lowercase extensions are listed as
+		// prefix + relative path, with forward slashes
+		indexer(std::vector<std::string> extensions, std::string prefix, std::string index_file);
+		~indexer();
+
+		indexer(const indexer&) = delete;
+		auto operator=(const indexer&) -> indexer& = delete;
+
+		auto scan(const std::string& root) -> scan_stats;
+
+		// Scans on a pool job and calls on_done from that job. Calling
+		// this while a scan is running queues one more scan with the newest root.
+		auto scan_async(std::string root, callback on_done = nullptr) -> void;
+
+		auto is_running() const -> bool;
+
+		// True once the first scan has published its results
+		auto is_ready() const -> bool { return m_ready; }
+
+		// Sorted, safe to call from any thread. Never null.
+		auto get_files() const -> std::shared_ptr<const file_list>;
+		auto get_last_stats() const -> scan_stats;
+
+		auto shutdown() -> void;
+
+	private:
+		auto visit_directory(const std::string& root, const std::string& key, directory_entry& out) const -> bool;
+		auto has_extension(const std::string& name) const -> bool;
+		auto load_index() -> void;
+		auto save_index() const -> void;
+		auto worker_loop() -> void;
+
+		const std::vector<std::string> m_extensions;
+		const std::string m_prefix;
+		const std::string m_index_file;
+
+		// Only touched by scan(), which holds m_scan_mutex
+		std::mutex m_scan_mutex;
+		std::string m_root;
+		directory_map m_directories;
+		bool m_index_loaded = false;
+
+		mutable std::mutex m_published_mutex;
+		std::shared_ptr<const file_list> m_files;
+		scan_stats m_last_stats;
+		std::atomic<bool> m_ready{ false };
+
+		mutable std::mutex m_worker_mutex;
+		std::future<void> m_worker;
+		bool m_worker_running = false;
+		bool m_has_pending = false;
+		std::string m_pending_root;
+		callback m_pending_callback;
+		std::atomic<bool> m_shutdown{ false };
+	};
+}
@@ -0,0 +1,169 @@
+#include "frame_scheduler.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <deque>
+#include <iterator>
+#include <mutex>
+#include <utility>
+
+namespace
+{
+	using clock = std::chrono::steady_clock;
+
+	struct entry
+	{
+		const char* name = "";
+		frame_scheduler::task fn;
+	};
+
+	std::mutex s_mutex;
+	std::array<std::deque<entry>, std::size_t(frame_scheduler::priority::count)> s_queues;
+	std::array<std::deque<entry>, std::size_t(frame_scheduler::priority::count)> s_next_frame;
+	frame_scheduler::stats s_stats;
+
+	// Takes the oldest task of the highest priority that has one
+	auto take(entry& next, std::size_t& level) -> bool
+	{
+		std::lock_guard<std::mutex> lock(s_mutex);
+
+		for(level = 0; level < s_queues.size(); ++level)
+		{
+			auto& queue = s_queues[level];
+			if(queue.empty())
+				continue;
+
+			next = std::move(queue.front());
+			queue.pop_front();
+			return true;
+		}
+
+		return false;
+	}
+
+	// Moves what was posted for this frame behind what's already queued
+	auto start_frame() -> void
+	{
+		std::lock_guard<std::mutex> lock(s_mutex);
+
+		for(auto level = std::size_t(0); level < s_queues.size(); ++level)
+		{
+			auto& waiting = s_next_frame[level];
+			auto& queue = s_queues[level];
+			std::move(waiting.begin(), waiting.end(), std::back_inserter(queue));
+			waiting.clear();
+		}
+	}
+}
+
+std::atomic<int> frame_scheduler::g_budget_us{ 4000 };
+
+auto frame_scheduler::post(const priority level, const char* name, task fn) -> void
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+	s_queues[std::size_t(level)].push_back({ name, std::move(fn) });
+}
+
+auto frame_scheduler::post_next_frame(const priority level, const char* name, task fn) -> void
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+	s_next_frame[std::size_t(level)].push_back({ name, std::move(fn) });
+}
+
+auto frame_scheduler::run() -> void
+{
+	start_frame();
+
+	const auto start = clock::now();
+	const auto budget = std::chrono::microseconds((std::max)(g_budget_us.load(), 0));
+
+	std::uint64_t slices = 0;
+	std::uint64_t completed = 0;
+
+	entry next;
+	auto level = std::size_t(0);
+	while(take(next, level))
+	{
+		auto done = true;
+		{
+			trace::scope span(next.name);
+
+			// An exception here would unwind through the engine
+			try
+			{
+				done = next.fn();
+			}
+			catch(...)
+			{
+			}
+		}
+
+		++slices;
+		if(done)
+			++completed;
+		else
+		{
+			// Behind the others of its priority, so one long task doesn't hog the slices
+			std::lock_guard<std::mutex> lock(s_mutex);
+			s_queues[level].push_back(std::move(next));
+		}
+
+		if(clock::now() - start >= budget)
+			break;
+	}
+
+	if(!slices)
+		return;
+
+	const auto frame_us = std::chrono::duration<double, std::micro>(clock::now() - start).count();
+
+	std::lock_guard<std::mutex> lock(s_mutex);
+	s_stats.last_frame_us = frame_us;
+	s_stats.worst_frame_us = (std::max)(s_stats.worst_frame_us, frame_us);
+	++s_stats.frames;
+	s_stats.over_budget += frame_us > double(budget.count());
+	s_stats.slices += slices;
+	s_stats.completed += completed;
+}
+
+auto frame_scheduler::clear() -> void
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+	for(auto& queue : s_queues)
+		queue.clear();
+	for(auto& queue : s_next_frame)
+		queue.clear();
+}
+
+auto frame_scheduler::get_stats() -> stats
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+
+	auto result = s_stats;
+	for(auto i = std::size_t(0); i < s_queues.size(); ++i)
+		result.queued[i] = s_queues[i].size() + s_next_frame[i].size();
+	return result;
+}
+
+auto frame_scheduler::reset_stats() -> void
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+	s_stats = stats();
+}
+
+auto frame_scheduler::get_name(const priority level) -> const char*
+{
+	switch(level)
+	{
+	case priority::high:
+		return "high";
+	case priority::normal:
+		return "normal";
+	case priority::low:
+		return "low";
+	default:
+		return "";
+	}
+}
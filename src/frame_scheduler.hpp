@@ -0,0 +1,59 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// Work that has to run on the game thread: string table adds, model loads,
+// full updates. Any thread can post; FrameStageNotify calls run() once a frame
+// and it runs tasks, highest priority first, until the frame's budget is used.
+//
+// A task returns true when it's done and false to be called again in a later
+// slice, so bulk work can stop between items instead of spiking one frame.
+// At least one slice runs every frame so nothing stalls on a tiny budget.
+namespace frame_scheduler
+{
+	enum class priority : std::uint8_t
+	{
+		high,   // Something on screen is waiting for it
+		normal,
+		low,
+		count
+	};
+
+	using task = std::function<bool()>;
+
+	// Game thread time per frame in microseconds
+	extern std::atomic<int> g_budget_us;
+
+	// Any thread. The name shows up in traces, string literals only.
+	auto post(priority level, const char* name, task fn) -> void;
+
+	// Like post, but the task runs no earlier than the next run(). For retrying
+	// work another thread is holding up without spinning through this frame's
+	// budget, and for freeing things the game thread may still be reading.
+	auto post_next_frame(priority level, const char* name, task fn) -> void;
+
+	// Game thread only
+	auto run() -> void;
+
+	// Drops everything queued. Called from uninitialize.
+	auto clear() -> void;
+
+	struct stats
+	{
+		std::size_t queued[std::size_t(priority::count)] = {};
+		double last_frame_us = 0.0;  // Spent in the last run that had work
+		double worst_frame_us = 0.0;
+		std::uint64_t frames = 0;    // Runs that had work
+		std::uint64_t over_budget = 0;
+		std::uint64_t slices = 0;
+		std::uint64_t completed = 0;
+	};
+
+	auto get_stats() -> stats;
+
+	auto reset_stats() -> void;
+
+	auto get_name(priority level) -> const char*;
+}
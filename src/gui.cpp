@@ -27,17 +27,28 @@
 #include "SDK.hpp"
 #include "kit_parser.hpp"
 #include "update_check.hpp"
+#include "Hooks/hooks.hpp"
+#include "nSkinz.hpp"
 
 #include <imgui.h>
 #include <functional>
 #include <algorithm>
 #include <cctype>
 #include <cstring>
+#include <mutex>
 #include <string>
 #include <string_view>
 #include <utility>
 #include <vector>
 #include "model_changer.hpp"
+#include "model_validator.hpp"
+#include "sequence_remap.hpp"
+#include "sticker_changer.hpp"
+#include "profiler.hpp"
+#include "trace.hpp"
+#include "frame_scheduler.hpp"
+#include "hot_reload.hpp"
+#include "Utilities/jobs.hpp"
 
 namespace ImGui
 {
@@ -243,6 +254,7 @@ namespace
 		strncpy_s(destination, value, _TRUNCATE);
 		rule.precached_index = -1;
 		rule.is_patched = false;
+		model_changer::mark_rules_changed();
 		return true;
 	}
 
@@ -250,6 +262,7 @@ namespace
 	{
 		rule.precached_index = -1;
 		rule.is_patched = false;
+		model_changer::mark_rules_changed();
 	}
 
 	static const char* model_basename(const char* path)
@@ -330,8 +343,63 @@ namespace
 		}
 	}
 
+	static void draw_model_memory_popup(const model_changer::precache_stats& stats)
+	{
+		if (!ImGui::BeginPopup("##model_memory"))
+			return;
+
+		ImGui::Text("Custom model memory");
+		ImGui::Separator();
+		ImGui::SetNextItemWidth(160.0f);
+		if (ImGui::InputInt("Budget (MB)", &model_changer::g_model_budget_mb, 16, 64))
+			model_changer::g_model_budget_mb = (std::max)(0, model_changer::g_model_budget_mb);
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("0 keeps every loaded model resident. Over budget, the least recently used\nmodels are released and reload the next time they are used.");
+
+		const double budget_mb = model_changer::g_model_budget_mb;
+		ImGui::Text("Resident: %d models, %.1f MB%s", stats.resident_models,
+			static_cast<double>(stats.resident_bytes) / (1024.0 * 1024.0), budget_mb > 0 ? "" : " (no budget)");
+		ImGui::TextDisabled("Evicted %d times, reloaded %d times this map", stats.evictions, stats.reloads);
+
+		const auto models = model_changer::get_resident_models();
+		if (ImGui::BeginTable("##resident_models", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY,
+			ImVec2(520.0f, ImGui::GetTextLineHeightWithSpacing() * 10.0f)))
+		{
+			ImGui::TableSetupScrollFreeze(0, 1);
+			ImGui::TableSetupColumn("Model", ImGuiTableColumnFlags_WidthStretch);
+			ImGui::TableSetupColumn("Size", ImGuiTableColumnFlags_WidthFixed, 70.0f);
+			ImGui::TableSetupColumn("Last used", ImGuiTableColumnFlags_WidthFixed, 70.0f);
+			ImGui::TableSetupColumn("State", ImGuiTableColumnFlags_WidthFixed, 60.0f);
+			ImGui::TableHeadersRow();
+			for (const auto& model : models)
+			{
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(model_basename(model.path.c_str()));
+				if (ImGui::IsItemHovered())
+					ImGui::SetTooltip("%s", model.path.c_str());
+				ImGui::TableNextColumn();
+				ImGui::Text("%.2f MB", static_cast<double>(model.bytes) / (1024.0 * 1024.0));
+				ImGui::TableNextColumn();
+				ImGui::Text("%.0f s ago", model.idle_seconds);
+				ImGui::TableNextColumn();
+				if (model.resident)
+					ImGui::TextColored(ImVec4(0.35f, 0.95f, 0.45f, 1.0f), "Loaded");
+				else
+					ImGui::TextDisabled("Evicted");
+			}
+			ImGui::EndTable();
+		}
+		if (models.empty())
+			ImGui::TextDisabled("No custom models are loaded on this map.");
+
+		ImGui::EndPopup();
+	}
+
 	static void draw_model_changer_tab()
 	{
+		// A hot reload replaces the rules on the game thread, not while we hold references
+		const std::lock_guard<std::recursive_mutex> rules_lock(model_changer::g_rules_mutex);
 		auto& rules = model_changer::g_replacements;
 		static int selected_rule = -1;
 		static int target_category = 0;
@@ -341,6 +409,8 @@ namespace
 		static char installed_search[96] = "";
 		static std::vector<int> filtered_models;
 		static bool initial_scan_done = false;
+		const auto validation = model_validator::get_results();
+		const auto installed_models = std::atomic_load(&model_changer::g_installed_models);
 
 		if (!initial_scan_done)
 		{
@@ -355,13 +425,17 @@ namespace
 			selected_rule = std::clamp(selected_rule < 0 ? 0 : selected_rule, 0, static_cast<int>(rules.size()) - 1);
 
 		// Compact global controls and diagnostics.
-		if (ImGui::BeginChild("##model_status", ImVec2(0, ImGui::GetFrameHeightWithSpacing() * 2.65f), ImGuiChildFlags_Borders))
+		if (ImGui::BeginChild("##model_status", ImVec2(0, ImGui::GetFrameHeightWithSpacing() * 3.65f), ImGuiChildFlags_Borders))
 		{
 			ImGui::Checkbox("Enable replacements", &model_changer::g_enabled);
 			ImGui::SameLine();
 			ImGui::Checkbox("Custom weapon sounds", &model_changer::g_enable_custom_sounds);
 			if (ImGui::IsItemHovered())
 				ImGui::SetTooltip("Redirect matching local weapon sounds to csgo/sound/custom/.");
+			ImGui::SameLine();
+			ImGui::Checkbox("Load on demand", &model_changer::g_lazy_precache);
+			if (ImGui::IsItemHovered())
+				ImGui::SetTooltip("Load a replacement when its weapon is first held instead of when the map starts.\nRules marked for prefetch still load with the map.");
 
 			const auto active_color = ImVec4(0.35f, 0.95f, 0.45f, 1.0f);
 			const auto failed_color = ImVec4(1.0f, 0.35f, 0.35f, 1.0f);
@@ -378,15 +452,37 @@ namespace
 				ImGui::SetTooltip("%s", model_changer::g_svpure_status);
 
 			char refresh_label[96];
-			snprintf(refresh_label, sizeof(refresh_label), "%s (%d)",
-				model_changer::g_models_scanned ? "Refresh model list" : "Scan installed models",
-				static_cast<int>(model_changer::g_installed_models.size()));
-			const float refresh_width = ImGui::CalcTextSize(refresh_label).x + ImGui::GetStyle().FramePadding.x * 2.0f;
+			snprintf(refresh_label, sizeof(refresh_label), "%s (%d)###refresh_models",
+				model_changer::is_scanning() ? "Scanning..."
+					: model_changer::g_models_scanned ? "Refresh model list" : "Scan installed models",
+				static_cast<int>(installed_models->size()));
+			const float refresh_width = ImGui::CalcTextSize(refresh_label, nullptr, true).x + ImGui::GetStyle().FramePadding.x * 2.0f;
 			ImGui::SameLine(ImGui::GetWindowContentRegionMax().x - refresh_width);
+			ImGui::BeginDisabled(model_changer::is_scanning());
 			if (ImGui::Button(refresh_label))
 				model_changer::scan_installed_models();
+			ImGui::EndDisabled();
 			if (ImGui::IsItemHovered() && !model_changer::g_models_root.empty())
-				ImGui::SetTooltip("Scanned folder:\n%s", model_changer::g_models_root.c_str());
+			{
+				const auto stats = model_validator::get_last_stats();
+				if (model_validator::is_running())
+					ImGui::SetTooltip("Scanned folder:\n%s\nValidating model headers...", model_changer::g_models_root.c_str());
+				else
+					ImGui::SetTooltip("Scanned folder:\n%s\nValidated %d models in %.0f ms (%d invalid, %d unchanged)",
+						model_changer::g_models_root.c_str(), stats.total, stats.milliseconds, stats.invalid, stats.reused);
+			}
+
+			const auto precache_stats = model_changer::get_precache_stats();
+			ImGui::TextDisabled("%s loading: %d models loaded (%.1f MB)  |  map load %.0f ms  |  on demand %d (%.0f ms, worst %.1f ms)",
+				precache_stats.lazy ? "Lazy" : "Eager", precache_stats.resident_models,
+				static_cast<double>(precache_stats.resident_bytes) / (1024.0 * 1024.0), precache_stats.map_load_ms,
+				precache_stats.on_demand_loads, precache_stats.on_demand_ms, precache_stats.worst_on_demand_ms);
+			if (ImGui::IsItemHovered())
+				ImGui::SetTooltip("For the current map. Sizes are of the loaded .mdl files; vertex data is not included.");
+			ImGui::SameLine();
+			if (ImGui::SmallButton("Memory..."))
+				ImGui::OpenPopup("##model_memory");
+			draw_model_memory_popup(precache_stats);
 		}
 		ImGui::EndChild();
 
@@ -416,7 +512,8 @@ namespace
 
 						++visible_rules;
 						ImGui::PushID(i);
-						ImGui::Checkbox("##enabled", &rule.enabled);
+						if (ImGui::Checkbox("##enabled", &rule.enabled))
+							model_changer::mark_rules_changed();
 						if (ImGui::IsItemHovered())
 							ImGui::SetTooltip(rule.enabled ? "Disable this rule" : "Enable this rule");
 						ImGui::SameLine();
@@ -426,8 +523,11 @@ namespace
 							rule.original[0] ? model_basename(rule.original) : "Choose target",
 							rule.replacement[0] ? model_basename(rule.replacement) : "Choose replacement");
 						const bool incomplete = rule.original[0] == '\0' || rule.replacement[0] == '\0';
+						const auto checked = model_validator::find(*validation, rule.replacement);
+						const bool invalid = checked && checked->is_rejected();
 						const ImVec4 row_color = !rule.enabled ? ImVec4(0.55f, 0.55f, 0.55f, 1.0f)
 							: incomplete ? ImVec4(1.0f, 0.72f, 0.25f, 1.0f)
+							: invalid ? ImVec4(1.0f, 0.35f, 0.35f, 1.0f)
 							: rule.precached_index > 0 ? ImVec4(0.45f, 0.95f, 0.5f, 1.0f)
 							: ImGui::GetStyleColorVec4(ImGuiCol_Text);
 						ImGui::PushStyleColor(ImGuiCol_Text, row_color);
@@ -441,6 +541,8 @@ namespace
 							ImGui::Text("Match: %s", rule.original[0] ? rule.original : "(not set)");
 							ImGui::Text("Use:   %s", rule.replacement[0] ? rule.replacement : "(not set)");
 							ImGui::TextDisabled(rule.precached_index > 0 ? "Applied (index %d)" : "Not applied to the current map", rule.precached_index);
+							if (invalid)
+								ImGui::TextColored(ImVec4(1.0f, 0.35f, 0.35f, 1.0f), "Invalid model: %s", mdl::describe(checked->status));
 							ImGui::EndTooltip();
 						}
 						ImGui::PopID();
@@ -470,6 +572,7 @@ namespace
 				if (ImGui::Button("Remove", ImVec2(third, 0)))
 				{
 					rules.erase(rules.begin() + selected_rule);
+					model_changer::mark_rules_changed();
 					selected_rule = rules.empty() ? -1 : (std::min)(selected_rule, static_cast<int>(rules.size()) - 1);
 				}
 				ImGui::EndDisabled();
@@ -479,6 +582,7 @@ namespace
 				if (ImGui::Button("Move up", ImVec2(half, 0)))
 				{
 					std::swap(rules[selected_rule], rules[selected_rule - 1]);
+					model_changer::mark_rules_changed();
 					--selected_rule;
 				}
 				ImGui::EndDisabled();
@@ -487,6 +591,7 @@ namespace
 				if (ImGui::Button("Move down", ImVec2(half, 0)))
 				{
 					std::swap(rules[selected_rule], rules[selected_rule + 1]);
+					model_changer::mark_rules_changed();
 					++selected_rule;
 				}
 				ImGui::EndDisabled();
@@ -509,16 +614,28 @@ namespace
 				else
 				{
 					auto& rule = rules[selected_rule];
-					ImGui::Checkbox("Rule enabled", &rule.enabled);
+					const auto checked = model_validator::find(*validation, rule.replacement);
+					if (ImGui::Checkbox("Rule enabled", &rule.enabled))
+						model_changer::mark_rules_changed();
 					ImGui::SameLine();
 					if (!rule.enabled)
 						ImGui::TextDisabled("Disabled");
 					else if (rule.original[0] == '\0' || rule.replacement[0] == '\0')
 						ImGui::TextColored(ImVec4(1.0f, 0.72f, 0.25f, 1.0f), "Incomplete");
+					else if (checked && checked->is_rejected())
+						ImGui::TextColored(ImVec4(1.0f, 0.35f, 0.35f, 1.0f), "Invalid model");
 					else if (rule.precached_index > 0)
 						ImGui::TextColored(ImVec4(0.35f, 0.95f, 0.45f, 1.0f), "Applied (model index %d)", rule.precached_index);
+					else if (model_changer::g_lazy_precache && !rule.prefetch)
+						ImGui::TextColored(ImVec4(0.45f, 0.75f, 1.0f, 1.0f), "Loads when first held");
 					else
 						ImGui::TextColored(ImVec4(0.45f, 0.75f, 1.0f, 1.0f), "Ready to apply");
+					if (model_changer::g_lazy_precache)
+					{
+						ImGui::Checkbox("Prefetch at map start", &rule.prefetch);
+						if (ImGui::IsItemHovered())
+							ImGui::SetTooltip("Load this rule with the map instead of when its weapon is first held.");
+					}
 					ImGui::Separator();
 
 					ImGui::Text("1. Choose the original model");
@@ -576,9 +693,9 @@ namespace
 					ImGui::InputTextWithHint("##installed_search", "Search installed models...", installed_search, sizeof(installed_search));
 
 					filtered_models.clear();
-					for (int i = 0; i < static_cast<int>(model_changer::g_installed_models.size()); ++i)
+					for (int i = 0; i < static_cast<int>(installed_models->size()); ++i)
 					{
-						const auto& model = model_changer::g_installed_models[i];
+						const auto& model = (*installed_models)[i];
 						if (matches_model_type(model, installed_type) && contains_ci(model, installed_search))
 							filtered_models.push_back(i);
 					}
@@ -592,7 +709,7 @@ namespace
 						{
 							for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row)
 							{
-								const auto& model = model_changer::g_installed_models[filtered_models[row]];
+								const auto& model = (*installed_models)[filtered_models[row]];
 								const bool selected = equals_ci(model, rule.replacement);
 								if (ImGui::Selectable(model.c_str(), selected))
 									set_model_rule_text(rule.replacement, model.c_str(), rule);
@@ -607,7 +724,7 @@ namespace
 						ImGui::EndListBox();
 					}
 					ImGui::TextDisabled("%d shown / %d installed", static_cast<int>(filtered_models.size()),
-						static_cast<int>(model_changer::g_installed_models.size()));
+						static_cast<int>(installed_models->size()));
 
 					ImGui::SetNextItemWidth(-FLT_MIN);
 					if (ImGui::InputTextWithHint("##replacement_path", "Replacement path (models/.../*.mdl)",
@@ -615,7 +732,7 @@ namespace
 						invalidate_model_rule(rule);
 
 					bool installed = false;
-					for (const auto& model : model_changer::g_installed_models)
+					for (const auto& model : *installed_models)
 					{
 						if (equals_ci(model, rule.replacement))
 						{
@@ -644,9 +761,16 @@ namespace
 						ImGui::TextColored(ImVec4(1.0f, 0.35f, 0.35f, 1.0f), "Replacement must end in .mdl.");
 					else if (model_changer::g_models_scanned && !installed)
 						ImGui::TextColored(ImVec4(1.0f, 0.72f, 0.25f, 1.0f), "This path was not found in the loose model scan.");
+					else if (checked && checked->is_rejected())
+						ImGui::TextColored(ImVec4(1.0f, 0.35f, 0.35f, 1.0f), "Replacement is not a usable model: %s.", mdl::describe(checked->status));
 					else
 						ImGui::TextColored(ImVec4(0.35f, 0.95f, 0.45f, 1.0f), "Rule paths look ready.");
 
+					if (checked && checked->is_valid())
+						ImGui::TextDisabled("MDL v%d: %d bones, %d sequences, %d materials, %d body parts",
+							checked->header.version, checked->header.bone_count, checked->header.sequence_count,
+							checked->header.material_count, checked->header.body_part_count);
+
 					if (shadowing_rule >= 0)
 						ImGui::TextColored(ImVec4(1.0f, 0.72f, 0.25f, 1.0f),
 							"Rule %d has a broader earlier match; move this rule above it.", shadowing_rule + 1);
@@ -660,13 +784,12 @@ namespace
 		const float total_width = ImGui::GetContentRegionAvail().x;
 		const float apply_width = total_width * 0.5f;
 		const float side_width = (total_width - apply_width - gap * 2.0f) / 2.0f;
-		if (ImGui::Button("Apply to current map", ImVec2(apply_width, 0)))
-		{
+		// The view models are refreshed once the last rule has loaded
+		ImGui::BeginDisabled(model_changer::is_precaching());
+		if (ImGui::Button(model_changer::is_precaching() ? "Applying...###apply" : "Apply to current map###apply", ImVec2(apply_width, 0)))
 			model_changer::precache_models();
-			if (model_changer::g_last_operation_status != model_changer::operation_status::error && g_engine)
-				g_engine->ClientCmd_Unrestricted("record x;stop");
-		}
-		if (ImGui::IsItemHovered())
+		ImGui::EndDisabled();
+		if (ImGui::IsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled))
 			ImGui::SetTooltip("Precache enabled models and refresh the current view models.");
 		ImGui::SameLine();
 		if (ImGui::Button("Save rules", ImVec2(side_width, 0)))
@@ -681,13 +804,15 @@ namespace
 		}
 
 		ImGui::PushStyleColor(ImGuiCol_Text, operation_color(model_changer::g_last_operation_status));
-		ImGui::TextWrapped("%s", model_changer::g_last_operation_message.c_str());
+		ImGui::TextWrapped("%s", model_changer::get_last_operation_message().c_str());
 		ImGui::PopStyleColor();
 	}
 }
 
 void draw_gui()
 {
+	profiler::scoped_timer timer(profiler::hook_id::draw_gui);
+
 	ImGui::SetNextWindowSize(ImVec2(900, 620));
 	if(ImGui::Begin("nSkinz", nullptr,
 		ImGuiWindowFlags_NoResize |
@@ -701,8 +826,50 @@ void draw_gui()
 	// ========== SKIN CHANGER TAB ==========
 	if (ImGui::BeginTabItem("Skin Changer"))
 	{
+		// A hot reload replaces profiles and items on the game thread, not while we hold references
+		const auto config_lock = g_config.lock();
+
+		// Profile selection, before the items so a switch shows this frame
+		{
+			const auto active = g_config.get_active_profile();
+			auto& active_profile = g_config.get_profile(active);
+
+			ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x * 0.35f);
+			if (ImGui::BeginCombo("##profile", active_profile.name))
+			{
+				for (auto i = std::size_t(0); i < g_config.get_profile_count(); ++i)
+				{
+					ImGui::PushID(int(i));
+					if (ImGui::Selectable(g_config.get_profile(i).name, i == active))
+						g_config.activate_profile(i);
+					ImGui::PopID();
+				}
+				ImGui::EndCombo();
+			}
+			if (ImGui::IsItemHovered())
+				ImGui::SetTooltip("Switching only re-applies the weapons the profiles set differently.");
+			ImGui::SameLine();
+
+			ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x * 0.5f);
+			ImGui::InputText("##profile_name", active_profile.name, sizeof(active_profile.name));
+			ImGui::SameLine();
+
+			if (ImGui::Button("Copy##profile"))
+			{
+				char name[32];
+				sprintf_s(name, "Profile %d", int(g_config.get_profile_count()) + 1);
+				g_config.activate_profile(g_config.add_profile(name));
+			}
+			ImGui::SameLine();
+
+			if (ImGui::Button("Delete##profile") && g_config.get_profile_count() > 1)
+				g_config.remove_profile(active);
+
+			ImGui::Separator();
+		}
 
 		auto& entries = g_config.get_items();
+		auto changed = false;
 
 		static auto selected_id = 0;
 
@@ -724,13 +891,17 @@ void draw_gui()
 
 			if(ImGui::Button("Add", button_size))
 			{
+				changed = true;
 				entries.push_back(item_setting());
 				selected_id = entries.size() - 1;
 			}
 			ImGui::SameLine();
 
 			if(ImGui::Button("Remove", button_size) && entries.size() > 1)
+			{
+				changed = true;
 				entries.erase(entries.begin() + selected_id);
+			}
 
 			ImGui::PopItemWidth();
 		}
@@ -746,22 +917,22 @@ void draw_gui()
 			ImGui::InputText("Name", selected_entry.name, 32);
 
 			// Item to change skins for
-			ImGui::Combo("Item", &selected_entry.definition_vector_index, [](void* data, int idx) -> const char*
+			changed |= ImGui::Combo("Item", &selected_entry.definition_vector_index, [](void* data, int idx) -> const char*
 			{
 				return game_data::weapon_names[idx].name;
 			}, nullptr, (int)game_data::weapon_names.size(), 5);
 
 			// Enabled
-			ImGui::Checkbox("Enabled", &selected_entry.enabled);
+			changed |= ImGui::Checkbox("Enabled", &selected_entry.enabled);
 
 			// Pattern Seed
-			ImGui::InputInt("Seed", &selected_entry.seed);
+			changed |= ImGui::InputInt("Seed", &selected_entry.seed);
 
 			// Custom StatTrak number
-			ImGui::InputInt("StatTrak", &selected_entry.stat_trak);
+			changed |= ImGui::InputInt("StatTrak", &selected_entry.stat_trak);
 
 			// Wear Float
-			ImGui::SliderFloat("Wear", &selected_entry.wear, FLT_MIN, 1.f, "%.10f", ImGuiSliderFlags_Logarithmic);
+			changed |= ImGui::SliderFloat("Wear", &selected_entry.wear, FLT_MIN, 1.f, "%.10f", ImGuiSliderFlags_Logarithmic);
 
 			// Paint kit with search
 			static char skin_search[64] = "";
@@ -770,17 +941,17 @@ void draw_gui()
 
 			if(selected_entry.definition_index != GLOVE_T_SIDE)
 			{
-				FilteredCombo("Paint Kit", &selected_entry.paint_kit_vector_index, skin_search, sizeof(skin_search),
+				changed |= FilteredCombo("Paint Kit", &selected_entry.paint_kit_vector_index, skin_search, sizeof(skin_search),
 					game_data::skin_kits, filtered);
 			}
 			else
 			{
-				FilteredCombo("Paint Kit", &selected_entry.paint_kit_vector_index, glove_search, sizeof(glove_search),
+				changed |= FilteredCombo("Paint Kit", &selected_entry.paint_kit_vector_index, glove_search, sizeof(glove_search),
 					game_data::glove_kits, filtered);
 			}
 
 			// Quality
-			ImGui::Combo("Quality", &selected_entry.entity_quality_vector_index, [](void* data, int idx) -> const char*
+			changed |= ImGui::Combo("Quality", &selected_entry.entity_quality_vector_index, [](void* data, int idx) -> const char*
 			{
 				return game_data::quality_names[idx].name;
 			}, nullptr, (int)game_data::quality_names.size(), 5);
@@ -791,14 +962,14 @@ void draw_gui()
 			// Item defindex override
 			if(selected_entry.definition_index == WEAPON_KNIFE)
 			{
-				ImGui::Combo("Knife", &selected_entry.definition_override_vector_index, [](void* data, int idx) -> const char*
+				changed |= ImGui::Combo("Knife", &selected_entry.definition_override_vector_index, [](void* data, int idx) -> const char*
 				{
 					return game_data::knife_names.at(idx).name;
 				}, nullptr, (int)game_data::knife_names.size(), 5);
 			}
 			else if(selected_entry.definition_index == GLOVE_T_SIDE)
 			{
-				ImGui::Combo("Glove", &selected_entry.definition_override_vector_index, [](void* data, int idx) -> const char*
+				changed |= ImGui::Combo("Glove", &selected_entry.definition_override_vector_index, [](void* data, int idx) -> const char*
 				{
 					return game_data::glove_names.at(idx).name;
 				}, nullptr, (int)game_data::glove_names.size(), 5);
@@ -814,7 +985,7 @@ void draw_gui()
 			selected_entry.update<sync_type::KEY_TO_VALUE>();
 
 			// Custom Name tag
-			ImGui::InputText("Name Tag", selected_entry.custom_name, 32);
+			changed |= ImGui::InputText("Name Tag", selected_entry.custom_name, 32);
 		}
 
 		ImGui::NextColumn();
@@ -848,14 +1019,14 @@ void draw_gui()
 
 			static char sticker_search[64] = "";
 			static std::vector<int> sticker_filtered;
-			FilteredCombo("Sticker Kit", &selected_sticker.kit_vector_index, sticker_search, sizeof(sticker_search),
+			changed |= FilteredCombo("Sticker Kit", &selected_sticker.kit_vector_index, sticker_search, sizeof(sticker_search),
 				game_data::sticker_kits, sticker_filtered);
 
-			ImGui::SliderFloat("Wear", &selected_sticker.wear, FLT_MIN, 1.f, "%.10f", ImGuiSliderFlags_Logarithmic);
+			changed |= ImGui::SliderFloat("Wear", &selected_sticker.wear, FLT_MIN, 1.f, "%.10f", ImGuiSliderFlags_Logarithmic);
 
-			ImGui::SliderFloat("Scale", &selected_sticker.scale, 0.1f, 5.f, "%.3f");
+			changed |= ImGui::SliderFloat("Scale", &selected_sticker.scale, 0.1f, 5.f, "%.3f");
 
-			ImGui::SliderFloat("Rotation", &selected_sticker.rotation, 0.f, 360.f);
+			changed |= ImGui::SliderFloat("Rotation", &selected_sticker.rotation, 0.f, 360.f);
 
 			ImGui::NextColumn();
 
@@ -874,9 +1045,9 @@ void draw_gui()
 		{
 			const auto button_size = ImVec2(ImGui::GetColumnWidth() - 1, 20);
 
+			// Only the items that changed since the last update, a full update if one has to be reverted
 			if(ImGui::Button("Update", button_size))
-				//(*g_client_state)->ForceFullUpdate();
-				g_engine->ClientCmd_Unrestricted("record x;stop"); //this will be changed at a later date.		
+				g_config.refresh();
 
 
 			ImGui::NextColumn();
@@ -890,6 +1061,9 @@ void draw_gui()
 			ImGui::NextColumn();
 		}
 
+		if(changed)
+			g_config.mark_changed();
+
 		ImGui::PopItemWidth();
 		ImGui::Columns(1);
 
@@ -906,10 +1080,56 @@ void draw_gui()
 	// ========== MISC TAB ==========
 	if (ImGui::BeginTabItem("Misc"))
 	{
+		const auto config_lock = g_config.lock();
 		ImGui::Spacing();
 		ImGui::TextColored(ImVec4(0.4f, 1.0f, 0.6f, 1.0f), "Hitmarker Settings:");
 		ImGui::Checkbox("Enable Screen Hitmarker", &g_config.misc.hitmarker);
 		ImGui::Checkbox("Enable Hit Sound", &g_config.misc.hitsound);
+
+		ImGui::Spacing();
+		ImGui::Separator();
+		ImGui::Spacing();
+
+		ImGui::TextColored(ImVec4(0.4f, 1.0f, 0.6f, 1.0f), "Knife Animations:");
+		ImGui::TextDisabled("%s; %d generated from model activities", sequence_remap::get_status().c_str(),
+			sequence_remap::get_generated_count());
+		if (ImGui::Button("Reload nSkinz_sequences.json"))
+			sequence_remap::load();
+
+		ImGui::Spacing();
+		ImGui::Separator();
+		ImGui::Spacing();
+
+		ImGui::TextColored(ImVec4(0.4f, 1.0f, 0.6f, 1.0f), "Config Files:");
+		auto hot_reload_enabled = hot_reload::g_enabled.load();
+		if (ImGui::Checkbox("Reload configs edited outside the game", &hot_reload_enabled))
+			hot_reload::g_enabled = hot_reload_enabled;
+		ImGui::TextDisabled("%s", hot_reload::get_status().c_str());
+
+		ImGui::Spacing();
+		ImGui::Separator();
+		ImGui::Spacing();
+
+		ImGui::TextColored(ImVec4(0.4f, 1.0f, 0.6f, 1.0f), "Statistics:");
+		ImGui::Text("Item updates: %u applied, %u skipped, %u refreshed",
+			hooks::g_item_apply_counters.applied.load(), hooks::g_item_apply_counters.skipped.load(),
+			hooks::g_item_apply_counters.refreshed.load());
+
+		ImGui::Text("Dynamic hooks: %u installs", hooks::g_dynamic_hook_installs.load());
+
+		if (g_startup_timings.parallel)
+			ImGui::Text("Startup: %.1f ms, steps add up to %.1f ms (%.1f ms saved)", g_startup_timings.wall_ms,
+				g_startup_timings.serial_ms, g_startup_timings.serial_ms - g_startup_timings.wall_ms);
+		else
+			ImGui::Text("Startup: %.1f ms, serial", g_startup_timings.wall_ms);
+
+		const auto job_stats = jobs::get_stats();
+		ImGui::Text("Jobs: %zu workers, %zu executed, %zu stolen, %zu cancelled",
+			job_stats.workers, job_stats.executed, job_stats.stolen, job_stats.cancelled);
+
+		const auto sticker_hook = get_sticker_hook_stats();
+		ImGui::Text("Sticker hook: %zu instances hooked, %zu already hooked, %zu tracked, %zu calls forwarded",
+			sticker_hook.instances_hooked, sticker_hook.already_hooked, sticker_hook.tracked, sticker_hook.calls_forwarded);
 		
 		ImGui::Spacing();
 		ImGui::Separator();
@@ -924,6 +1144,110 @@ void draw_gui()
 		ImGui::EndTabItem();
 	}
 
+	// ========== PROFILER TAB ==========
+	if (ImGui::BeginTabItem("Profiler"))
+	{
+		auto enabled = profiler::g_enabled.load();
+		if (ImGui::Checkbox("Enabled", &enabled))
+			profiler::g_enabled = enabled;
+		ImGui::SameLine();
+		if (ImGui::Button("Reset"))
+			profiler::reset();
+
+		ImGui::TextDisabled("Time spent in our hooks, not counting the original call unless noted. FindMDL and EmitSound include the engine's.");
+
+		ImGui::Spacing();
+		ImGui::Separator();
+		ImGui::Spacing();
+
+		ImGui::Columns(7, "##profiler", false);
+		for (const auto header : { "Hook", "Calls", "Total ms", "Avg us", "p50 us", "p99 us", "Max us" })
+		{
+			ImGui::TextColored(ImVec4(0.4f, 1.0f, 0.6f, 1.0f), "%s", header);
+			ImGui::NextColumn();
+		}
+
+		for (const auto& stats : profiler::get_stats())
+		{
+			ImGui::Text("%s", stats.name);
+			ImGui::NextColumn();
+			ImGui::Text("%llu", static_cast<unsigned long long>(stats.calls));
+			ImGui::NextColumn();
+			ImGui::Text("%.2f", stats.total_ms);
+			ImGui::NextColumn();
+			ImGui::Text("%.2f", stats.average_us);
+			ImGui::NextColumn();
+			ImGui::Text("%.2f", stats.p50_us);
+			ImGui::NextColumn();
+			ImGui::Text("%.2f", stats.p99_us);
+			ImGui::NextColumn();
+			ImGui::Text("%.2f", stats.max_us);
+			ImGui::NextColumn();
+		}
+		ImGui::Columns(1);
+
+		if (const auto dropped = profiler::get_dropped())
+			ImGui::TextDisabled("%llu samples dropped, a ring buffer was full", static_cast<unsigned long long>(dropped));
+
+		ImGui::Spacing();
+		ImGui::Separator();
+		ImGui::Spacing();
+
+		ImGui::TextColored(ImVec4(0.4f, 1.0f, 0.6f, 1.0f), "Game thread queue:");
+		ImGui::TextDisabled("Engine work like model and sound precaching, run in slices each frame");
+
+		auto budget_us = frame_scheduler::g_budget_us.load();
+		if (ImGui::SliderInt("Budget per frame (us)", &budget_us, 250, 16000))
+			frame_scheduler::g_budget_us = budget_us;
+
+		const auto queue = frame_scheduler::get_stats();
+		ImGui::Text("Queued: %zu %s, %zu %s, %zu %s",
+			queue.queued[0], frame_scheduler::get_name(frame_scheduler::priority::high),
+			queue.queued[1], frame_scheduler::get_name(frame_scheduler::priority::normal),
+			queue.queued[2], frame_scheduler::get_name(frame_scheduler::priority::low));
+		ImGui::Text("Last busy frame: %.0f us (%.0f%% of budget), worst %.0f us",
+			queue.last_frame_us, budget_us > 0 ? 100.0 * queue.last_frame_us / budget_us : 0.0, queue.worst_frame_us);
+		ImGui::Text("%llu busy frames, %llu over budget, %llu slices, %llu tasks done",
+			static_cast<unsigned long long>(queue.frames), static_cast<unsigned long long>(queue.over_budget),
+			static_cast<unsigned long long>(queue.slices), static_cast<unsigned long long>(queue.completed));
+		if (ImGui::Button("Reset##queue"))
+			frame_scheduler::reset_stats();
+
+		ImGui::Spacing();
+		ImGui::Separator();
+		ImGui::Spacing();
+
+		ImGui::TextColored(ImVec4(0.4f, 1.0f, 0.6f, 1.0f), "Trace:");
+		ImGui::TextDisabled("Startup and hook activity as Chrome trace JSON, open it in chrome://tracing or ui.perfetto.dev");
+
+		if (trace::is_recording())
+		{
+			if (ImGui::Button("Stop recording"))
+				trace::stop();
+		}
+		else if (ImGui::Button("Start recording"))
+			trace::start();
+		ImGui::SameLine();
+		if (ImGui::Button("Save nSkinz_trace.json"))
+			trace::save("nSkinz_trace.json");
+		ImGui::SameLine();
+		if (ImGui::Button("Clear##trace"))
+			trace::clear();
+
+		ImGui::Text("%zu events%s", trace::get_event_count(), trace::is_recording() ? ", recording" : "");
+		if (const auto dropped = trace::get_dropped())
+		{
+			ImGui::SameLine();
+			ImGui::TextDisabled("(%zu dropped, the trace is full)", dropped);
+		}
+		if (trace::is_saving())
+			ImGui::TextDisabled("Saving nSkinz_trace.json...");
+		else if (const auto status = trace::get_save_status(); !status.empty())
+			ImGui::TextDisabled("%s", status.c_str());
+
+		ImGui::EndTabItem();
+	}
+
 	ImGui::EndTabBar();
 	} // End tab bar
 
@@ -1,6 +1,7 @@
 #include "hitmarker.hpp"
 #include "SDK.hpp"
 #include "config.hpp"
+#include "local_player.hpp"
 #include <Windows.h>
 #pragma comment(lib, "winmm.lib")
 #include <imgui.h>
@@ -57,7 +58,8 @@ namespace hitmarker
 		int attacker = g_engine->GetPlayerForUserID(event->GetInt("attacker"));
 		int userid = g_engine->GetPlayerForUserID(event->GetInt("userid"));
 
-		if (attacker == g_engine->GetLocalPlayer() && userid != g_engine->GetLocalPlayer())
+		const int local = local_player::get().index;
+		if (attacker == local && userid != local)
 		{
 			if (g_config.misc.hitsound)
 			{
@@ -0,0 +1,147 @@
+#include "hot_reload.hpp"
+#include "config.hpp"
+#include "frame_scheduler.hpp"
+#include "model_changer.hpp"
+#include "Utilities/file_watcher.hpp"
+#include "Utilities/jobs.hpp"
+
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace
+{
+	constexpr auto k_poll_interval = std::chrono::seconds(1);
+
+	std::unique_ptr<file_watcher> s_watcher;
+	std::atomic<bool> s_polling{ false };
+	std::chrono::steady_clock::time_point s_next_poll;
+
+	std::mutex s_status_mutex;
+	std::string s_status = "Not watching yet.";
+
+	auto set_status(std::string status) -> void
+	{
+		std::lock_guard<std::mutex> lock(s_status_mutex);
+		s_status = std::move(status);
+	}
+
+	// Game thread. The menu may be showing what this replaces, then it's tried
+	// again next frame instead of waiting on the render thread.
+	auto apply_config(std::shared_ptr<const config::file_contents> parsed, std::string path) -> bool
+	{
+		const auto lock = g_config.try_lock();
+		if(!lock.owns_lock())
+		{
+			frame_scheduler::post_next_frame(frame_scheduler::priority::normal, "reload config", [parsed, path]
+			{
+				return apply_config(parsed, path);
+			});
+			return true;
+		}
+
+		if(g_config.apply_changes(*parsed))
+			set_status("Reloaded " + path + ".");
+		return true;
+	}
+
+	auto apply_models(std::shared_ptr<const model_changer::config_contents> parsed, std::string path) -> bool
+	{
+		const std::unique_lock<std::recursive_mutex> lock(model_changer::g_rules_mutex, std::try_to_lock);
+		if(!lock.owns_lock())
+		{
+			frame_scheduler::post_next_frame(frame_scheduler::priority::normal, "reload models", [parsed, path]
+			{
+				return apply_models(parsed, path);
+			});
+			return true;
+		}
+
+		if(model_changer::apply_config_changes(*parsed))
+			set_status("Reloaded " + path + ".");
+		return true;
+	}
+
+	// Both on the poll job, the parse stays off the game thread
+	auto on_config_changed(const std::string& path, const std::string& contents) -> void
+	{
+		try
+		{
+			auto parsed = std::make_shared<const config::file_contents>(config::parse(contents));
+			frame_scheduler::post(frame_scheduler::priority::normal, "reload config", [parsed, path]
+			{
+				return apply_config(parsed, path);
+			});
+		}
+		catch(const std::exception& error)
+		{
+			set_status(path + " rejected, the current config was kept: " + error.what());
+		}
+	}
+
+	auto on_models_changed(const std::string& path, const std::string& contents) -> void
+	{
+		try
+		{
+			auto parsed = std::make_shared<const model_changer::config_contents>(model_changer::parse_config(contents));
+			frame_scheduler::post(frame_scheduler::priority::normal, "reload models", [parsed, path]
+			{
+				return apply_models(parsed, path);
+			});
+		}
+		catch(const std::exception& error)
+		{
+			set_status(path + " rejected, the current rules were kept: " + error.what());
+		}
+	}
+}
+
+std::atomic<bool> hot_reload::g_enabled{ true };
+
+auto hot_reload::initialize() -> void
+{
+	// A ReadDirectoryChangesW backend would slot in here
+	auto watcher = std::make_unique<poll_watcher>();
+	watcher->watch("nSkinz.json", on_config_changed);
+	watcher->watch("nSkinz_models.json", on_models_changed);
+	s_watcher = std::move(watcher);
+
+	set_status("Watching nSkinz.json and nSkinz_models.json.");
+}
+
+auto hot_reload::update() -> void
+{
+	if(!g_enabled || !s_watcher)
+		return;
+
+	const auto now = std::chrono::steady_clock::now();
+	if(now < s_next_poll || s_polling.exchange(true))
+		return;
+
+	s_next_poll = now + k_poll_interval;
+
+	const auto posted = jobs::post([]
+	{
+		try
+		{
+			s_watcher->poll();
+		}
+		catch(const std::exception&)
+		{
+			// Try again next time
+		}
+
+		s_polling = false;
+	});
+
+	if(!posted)
+		s_polling = false;
+}
+
+auto hot_reload::get_status() -> std::string
+{
+	std::lock_guard<std::mutex> lock(s_status_mutex);
+	return s_status;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <atomic>
+#include <string>
+
+// Picks up edits to nSkinz.json and nSkinz_models.json made outside the game.
+// A pool job polls the files about once a second and parses the ones that
+// changed; the game thread then takes over only what differs from the live
+// settings. A file that doesn't parse is rejected and the live settings stay.
+namespace hot_reload
+{
+	extern std::atomic<bool> g_enabled;
+
+	// Starts watching from the files' current state, after they were loaded
+	auto initialize() -> void;
+
+	// Game thread, every frame. Starts a poll when one is due.
+	auto update() -> void;
+
+	// The last reload or rejection, for the menu
+	auto get_status() -> std::string;
+}
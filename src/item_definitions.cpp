@@ -23,15 +23,29 @@
 * SOFTWARE.
 */
 #include "item_definitions.hpp"
-// These are std::vectors because else I'd have to write their size in the header or write my own container
 
-// We need these for overriding viewmodels and icons
-const game_data::weapon_info* game_data::get_weapon_info(int defindex)
+#include <array>
+#include <cstdint>
+#include <iterator>
+
+namespace
 {
-	const static std::map<int, weapon_info> info =
+	struct weapon_info_entry
+	{
+		constexpr weapon_info_entry(const int definition_index, const game_data::weapon_info info) :
+			definition_index(definition_index),
+			info(info)
+		{}
+
+		int definition_index;
+		game_data::weapon_info info;
+	};
+
+	// We need these for overriding viewmodels and icons. Order is the slot order of get_weapon_info_slot.
+	constexpr weapon_info_entry k_weapon_info[] =
 	{
-		{WEAPON_KNIFE,{"models/weapons/v_knife_default_ct.mdl", "knife_default_ct"}},
-		{WEAPON_KNIFE_T,{"models/weapons/v_knife_default_t.mdl", "knife_t"}},
+		{WEAPON_KNIFE, {"models/weapons/v_knife_default_ct.mdl", "knife_default_ct"}},
+		{WEAPON_KNIFE_T, {"models/weapons/v_knife_default_t.mdl", "knife_t"}},
 		{WEAPON_KNIFE_BAYONET, {"models/weapons/v_knife_bayonet.mdl", "bayonet"}},
 		{WEAPON_KNIFE_CSS, {"models/weapons/v_knife_css.mdl", "knife_css"}},
 		{WEAPON_KNIFE_FLIP, {"models/weapons/v_knife_flip.mdl", "knife_flip"}},
@@ -45,28 +59,92 @@ const game_data::weapon_info* game_data::get_weapon_info(int defindex)
 		{WEAPON_KNIFE_PUSH, {"models/weapons/v_knife_push.mdl", "knife_push"}},
 		{WEAPON_KNIFE_CORD, {"models/weapons/v_knife_cord.mdl", "knife_cord"}},
 		{WEAPON_KNIFE_CANIS, {"models/weapons/v_knife_canis.mdl", "knife_canis"}},
-		{WEAPON_KNIFE_URSUS,{"models/weapons/v_knife_ursus.mdl", "knife_ursus"}},
-		{WEAPON_KNIFE_GYPSY_JACKKNIFE,{"models/weapons/v_knife_gypsy_jackknife.mdl", "knife_gypsy_jackknife"}},
-		{WEAPON_KNIFE_OUTDOOR,{"models/weapons/v_knife_outdoor.mdl", "knife_outdoor"}},
-		{WEAPON_KNIFE_STILETTO,{"models/weapons/v_knife_stiletto.mdl", "knife_stiletto"}},
-		{WEAPON_KNIFE_WIDOWMAKER,{"models/weapons/v_knife_widowmaker.mdl", "knife_widowmaker"}},
-		{WEAPON_KNIFE_SKELETON,{"models/weapons/v_knife_skeleton.mdl", "knife_skeleton"}},
-		{GLOVE_BROKENFANG,{"models/weapons/v_models/arms/glove_bloodhound/v_glove_bloodhound_brokenfang.mdl"}},
-		{GLOVE_STUDDED_BLOODHOUND,{"models/weapons/v_models/arms/glove_bloodhound/v_glove_bloodhound.mdl"}},
-		{GLOVE_T_SIDE,{"models/weapons/v_models/arms/glove_fingerless/v_glove_fingerless.mdl"}},
-		{GLOVE_CT_SIDE,{"models/weapons/v_models/arms/glove_hardknuckle/v_glove_hardknuckle.mdl"}},
-		{GLOVE_SPORTY,{"models/weapons/v_models/arms/glove_sporty/v_glove_sporty.mdl"}},
-		{GLOVE_SLICK,{"models/weapons/v_models/arms/glove_slick/v_glove_slick.mdl"}},
-		{GLOVE_LEATHER_WRAP,{"models/weapons/v_models/arms/glove_handwrap_leathery/v_glove_handwrap_leathery.mdl"}},
-		{GLOVE_MOTORCYCLE,{"models/weapons/v_models/arms/glove_motorcycle/v_glove_motorcycle.mdl"}},
-		{GLOVE_SPECIALIST,{"models/weapons/v_models/arms/glove_specialist/v_glove_specialist.mdl"}},
-		{GLOVE_HYDRA,{"models/weapons/v_models/arms/glove_bloodhound/v_glove_bloodhound_hydra.mdl"}}
+		{WEAPON_KNIFE_URSUS, {"models/weapons/v_knife_ursus.mdl", "knife_ursus"}},
+		{WEAPON_KNIFE_GYPSY_JACKKNIFE, {"models/weapons/v_knife_gypsy_jackknife.mdl", "knife_gypsy_jackknife"}},
+		{WEAPON_KNIFE_OUTDOOR, {"models/weapons/v_knife_outdoor.mdl", "knife_outdoor"}},
+		{WEAPON_KNIFE_STILETTO, {"models/weapons/v_knife_stiletto.mdl", "knife_stiletto"}},
+		{WEAPON_KNIFE_WIDOWMAKER, {"models/weapons/v_knife_widowmaker.mdl", "knife_widowmaker"}},
+		{WEAPON_KNIFE_SKELETON, {"models/weapons/v_knife_skeleton.mdl", "knife_skeleton"}},
+		{GLOVE_BROKENFANG, {"models/weapons/v_models/arms/glove_bloodhound/v_glove_bloodhound_brokenfang.mdl"}},
+		{GLOVE_STUDDED_BLOODHOUND, {"models/weapons/v_models/arms/glove_bloodhound/v_glove_bloodhound.mdl"}},
+		{GLOVE_T_SIDE, {"models/weapons/v_models/arms/glove_fingerless/v_glove_fingerless.mdl"}},
+		{GLOVE_CT_SIDE, {"models/weapons/v_models/arms/glove_hardknuckle/v_glove_hardknuckle.mdl"}},
+		{GLOVE_SPORTY, {"models/weapons/v_models/arms/glove_sporty/v_glove_sporty.mdl"}},
+		{GLOVE_SLICK, {"models/weapons/v_models/arms/glove_slick/v_glove_slick.mdl"}},
+		{GLOVE_LEATHER_WRAP, {"models/weapons/v_models/arms/glove_handwrap_leathery/v_glove_handwrap_leathery.mdl"}},
+		{GLOVE_MOTORCYCLE, {"models/weapons/v_models/arms/glove_motorcycle/v_glove_motorcycle.mdl"}},
+		{GLOVE_SPECIALIST, {"models/weapons/v_models/arms/glove_specialist/v_glove_specialist.mdl"}},
+		{GLOVE_HYDRA, {"models/weapons/v_models/arms/glove_bloodhound/v_glove_bloodhound_hydra.mdl"}}
+	};
+
+	// Slots of one contiguous range of definition indices, -1 for the holes
+	template <int First, int Last>
+	class slot_range
+	{
+	public:
+		constexpr slot_range() :
+			m_slots()
+		{
+			for(auto& slot : m_slots)
+				slot = -1;
+
+			for(auto i = 0; i < int(std::size(k_weapon_info)); ++i)
+				if(contains(k_weapon_info[i].definition_index))
+					m_slots[k_weapon_info[i].definition_index - First] = std::int8_t(i);
+		}
+
+		constexpr static auto contains(const int definition_index) -> bool
+		{
+			return definition_index >= First && definition_index <= Last;
+		}
+
+		constexpr auto find(const int definition_index) const -> int
+		{
+			return contains(definition_index) ? m_slots[definition_index - First] : -1;
+		}
+
+	private:
+		std::array<std::int8_t, Last - First + 1> m_slots;
 	};
 
-	const auto entry = info.find(defindex);
-	return entry == end(info) ? nullptr : &entry->second;
+	// The default knives, the skinned knives and the gloves
+	constexpr slot_range<WEAPON_KNIFE, WEAPON_KNIFE_T> k_default_knife_slots;
+	constexpr slot_range<WEAPON_KNIFE_BAYONET, WEAPON_KNIFE_SKELETON> k_knife_slots;
+	constexpr slot_range<GLOVE_BROKENFANG, GLOVE_HYDRA> k_glove_slots;
+
+	constexpr auto find_slot(const int defindex) -> int
+	{
+		return k_knife_slots.contains(defindex) ? k_knife_slots.find(defindex)
+			: k_glove_slots.contains(defindex) ? k_glove_slots.find(defindex)
+			: k_default_knife_slots.find(defindex);
+	}
+
+	constexpr auto all_entries_reachable() -> bool
+	{
+		for(auto i = 0; i < int(std::size(k_weapon_info)); ++i)
+			if(find_slot(k_weapon_info[i].definition_index) != i)
+				return false;
+		return true;
+	}
 }
 
+static_assert(std::size(k_weapon_info) == game_data::weapon_info_count, "weapon_info_count is out of date");
+static_assert(std::size(k_weapon_info) <= 127, "slots are stored as int8_t");
+static_assert(all_entries_reachable(), "a weapon info entry is outside of the slot ranges or listed twice");
+static_assert(k_weapon_info[0].info.model_hash == FNV("models/weapons/v_knife_default_ct.mdl"), "weapon_info hash mismatch");
+
+int game_data::get_weapon_info_slot(int defindex)
+{
+	return find_slot(defindex);
+}
+
+const game_data::weapon_info* game_data::get_weapon_info(int defindex)
+{
+	const auto slot = find_slot(defindex);
+	return slot < 0 ? nullptr : &k_weapon_info[slot].info;
+}
+
+// These are std::vectors because else I'd have to write their size in the header or write my own container
 const std::vector<game_data::weapon_name> game_data::knife_names =
 {
 	{0, "Default"},
@@ -23,7 +23,9 @@
 * SOFTWARE.
 */
 #pragma once
-#include <map>
+#include "Utilities/fnv_hash.hpp"
+
+#include <cstddef>
 #include <vector>
 
 enum ItemDefinitionIndex : int
@@ -116,11 +118,17 @@ namespace game_data
 	{
 		constexpr weapon_info(const char* model, const char* icon = nullptr) :
 			model(model),
-			icon(icon)
+			icon(icon),
+			model_hash(fnv::hash_runtime(model)),
+			icon_hash(icon ? fnv::hash_runtime(icon) : 0)
 		{}
 
 		const char* model;
 		const char* icon;
+
+		// Same as fnv::hash_runtime of the strings, 0 without an icon
+		fnv::hash model_hash;
+		fnv::hash icon_hash;
 	};
 
 	struct weapon_name
@@ -146,6 +154,11 @@ namespace game_data
 	};
 
 	const weapon_info* get_weapon_info(int defindex);
+
+	// get_weapon_info entries are numbered 0 to weapon_info_count - 1, so data
+	// kept per entry can live in a plain array. -1 if there's no entry.
+	constexpr std::size_t weapon_info_count = 31;
+	int get_weapon_info_slot(int defindex);
 	extern const std::vector<weapon_name> knife_names;
 	extern const std::vector<weapon_name> glove_names;
 	extern const std::vector<weapon_name> weapon_names;
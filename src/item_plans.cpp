@@ -0,0 +1,147 @@
+#include "item_plans.hpp"
+#include "config.hpp"
+#include "item_definitions.hpp"
+#include "model_index_cache.hpp"
+#include "nSkinz.hpp"
+
+#include <array>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace
+{
+	// Past the highest glove, definition indices beyond it can't have a plan
+	constexpr auto k_max_definition_index = 0x1400;
+
+	std::vector<item_plans::plan> s_plans;
+
+	// 0 for none, else the plan's position plus one
+	std::array<std::uint16_t, k_max_definition_index> s_slots = {};
+
+	bool s_built = false;
+	unsigned s_config_generation = 0;
+	unsigned s_level_generation = 0;
+
+	auto compile(const item_setting& item) -> item_plans::plan
+	{
+		item_plans::plan p;
+
+		if(item.entity_quality_index)
+		{
+			p.fields |= item_plans::quality;
+			p.quality = item.entity_quality_index;
+		}
+
+		if(item.custom_name[0])
+		{
+			p.fields |= item_plans::custom_name;
+			strcpy_s(p.custom_name, item.custom_name);
+		}
+
+		if(item.paint_kit_index)
+		{
+			p.fields |= item_plans::paint_kit;
+			p.paint_kit = unsigned(item.paint_kit_index);
+		}
+
+		if(item.seed)
+		{
+			p.fields |= item_plans::seed;
+			p.seed = unsigned(item.seed);
+		}
+
+		if(item.stat_trak)
+		{
+			p.fields |= item_plans::stat_trak;
+			p.stat_trak = unsigned(item.stat_trak);
+		}
+
+		p.wear = item.wear;
+
+		if(item.definition_override_index && game_data::get_weapon_info(item.definition_override_index))
+		{
+			p.fields |= item_plans::definition_override;
+			p.definition_override = short(item.definition_override_index);
+			p.override_model_index = model_index_cache::get_model_index(item.definition_override_index);
+		}
+
+		return p;
+	}
+
+	// The kill feed shows the icon of the item the server sent, so every item
+	// an override can replace maps to the replacement's icon
+	auto add_icon_overrides(icon_override_table& icon_overrides, const item_setting& item) -> void
+	{
+		const auto replacement = game_data::get_weapon_info(item.definition_override_index);
+		if(!replacement || !replacement->icon)
+			return;
+
+		const auto add = [&](const int original_index)
+		{
+			const auto original = game_data::get_weapon_info(original_index);
+			if(original_index != item.definition_override_index && original && original->icon)
+				icon_overrides.set(original->icon_hash, replacement->icon);
+		};
+
+		// All knives are terrorist knives.
+		if(item.definition_index == WEAPON_KNIFE)
+		{
+			add(WEAPON_KNIFE);
+			add(WEAPON_KNIFE_T);
+			for(const auto& knife : game_data::knife_names)
+				add(knife.definition_index);
+		}
+		else
+			add(item.definition_index);
+	}
+}
+
+auto item_plans::update() -> void
+{
+	const auto config_generation = g_config.get_generation();
+	const auto level_generation = g_level_generation.load();
+	if(s_built && config_generation == s_config_generation && level_generation == s_level_generation)
+		return;
+
+	s_plans.clear();
+	s_slots.fill(0);
+	auto icon_overrides = std::make_shared<icon_override_table>();
+
+	for(const auto& item : g_config.get_items())
+	{
+		if(!item.enabled || item.definition_index < 0 || item.definition_index >= k_max_definition_index)
+			continue;
+
+		auto& slot = s_slots[item.definition_index];
+		if(slot)
+			continue;
+
+		s_plans.push_back(compile(item));
+		slot = std::uint16_t(s_plans.size());
+
+		if(s_plans.back().has(definition_override))
+			add_icon_overrides(*icon_overrides, item);
+	}
+
+	icon_overrides->sort();
+	g_config.set_icon_overrides(std::move(icon_overrides));
+
+	s_built = true;
+	s_config_generation = config_generation;
+	s_level_generation = level_generation;
+}
+
+auto item_plans::get_generation() -> unsigned
+{
+	return s_config_generation;
+}
+
+auto item_plans::find(const int definition_index) -> const plan*
+{
+	if(definition_index < 0 || definition_index >= k_max_definition_index)
+		return nullptr;
+
+	const auto slot = s_slots[definition_index];
+	return slot ? &s_plans[slot - 1] : nullptr;
+}
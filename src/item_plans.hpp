@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+
+// Every enabled item_setting compiled into only the writes PostDataUpdate has
+// to make, so applying one doesn't re-check each setting or look anything up.
+// Rebuilt when the config or the map changes, which also publishes a new kill
+// feed icon override table. Game thread only.
+namespace item_plans
+{
+	enum field : std::uint8_t
+	{
+		quality = 1 << 0,
+		custom_name = 1 << 1,
+		paint_kit = 1 << 2,
+		seed = 1 << 3,
+		stat_trak = 1 << 4,
+		definition_override = 1 << 5 // Only when we have info about the replacement
+	};
+
+	struct plan
+	{
+		std::uint8_t fields = 0;
+		short definition_override = 0;
+		int override_model_index = -1; // -1 while the model isn't precached
+		int quality = 0;
+		unsigned paint_kit = 0;
+		unsigned seed = 0;
+		unsigned stat_trak = 0;
+		float wear = 0.f;
+		char custom_name[32] = "";
+
+		auto has(const field f) const -> bool
+		{
+			return (fields & f) != 0;
+		}
+	};
+
+	// Rebuilds the plans if the config or the map changed since the last call
+	auto update() -> void;
+
+	// The config generation the plans were built from
+	auto get_generation() -> unsigned;
+
+	// The plan for a config's definition index, knives under WEAPON_KNIFE,
+	// null without an enabled item. First enabled item wins, like get_by_definition_index.
+	auto find(int definition_index) -> const plan*;
+}
@@ -0,0 +1,104 @@
+#include "local_player.hpp"
+#include "nSkinz.hpp"
+
+namespace
+{
+	local_player::snapshot s_snapshot;
+	bool s_valid = false;
+	bool s_in_update = false;
+	unsigned s_level_generation = 0;
+
+	template <typename T>
+	auto resolve(const sdk::CBaseHandle handle) -> local_player::cached_entity<T>
+	{
+		return { handle, get_entity_from_handle<T>(handle) };
+	}
+
+	// Without the weapons while an update is read, only the cached snapshot needs them
+	auto rebuild(const bool with_weapons) -> void
+	{
+		auto& snapshot = s_snapshot;
+		snapshot = local_player::snapshot();
+
+		snapshot.index = g_engine->GetLocalPlayer();
+		snapshot.player = static_cast<sdk::C_BasePlayer*>(g_entity_list->GetClientEntity(snapshot.index));
+
+		const auto local = snapshot.player;
+		if(!local)
+			return;
+
+		snapshot.alive = local->GetLifeState() == sdk::LifeState::ALIVE;
+
+		if(with_weapons)
+		{
+			for(const auto handle : local->GetWeapons())
+			{
+				if(handle == sdk::INVALID_EHANDLE_INDEX)
+					break;
+
+				snapshot.weapons[snapshot.weapon_count++] = resolve<sdk::C_BaseAttributableItem>(handle);
+			}
+		}
+
+		snapshot.view_model = resolve<sdk::C_BaseViewModel>(local->GetViewModel());
+		if(snapshot.view_model.entity)
+			snapshot.active_weapon.handle = snapshot.view_model.entity->GetWeapon();
+
+		snapshot.active_weapon.entity = local_player::get_weapon(snapshot.active_weapon.handle);
+	}
+}
+
+auto local_player::get() -> const snapshot&
+{
+	// Something read later in this update may delete what we'd cache
+	if(s_in_update)
+	{
+		rebuild(false);
+		return s_snapshot;
+	}
+
+	// A level change deletes every entity, maybe outside of a network update
+	if(!s_valid || s_level_generation != g_level_generation)
+	{
+		s_level_generation = g_level_generation;
+		// Set first, rebuild looks weapons up through the half built snapshot
+		s_valid = true;
+		rebuild(true);
+	}
+
+	return s_snapshot;
+}
+
+auto local_player::invalidate() -> void
+{
+	s_valid = false;
+}
+
+auto local_player::begin_network_update() -> void
+{
+	s_in_update = true;
+	s_valid = false;
+}
+
+auto local_player::end_network_update() -> void
+{
+	s_in_update = false;
+	s_valid = false;
+}
+
+auto local_player::get_weapon(const sdk::CBaseHandle handle) -> sdk::C_BaseAttributableItem*
+{
+	if(handle == sdk::INVALID_EHANDLE_INDEX)
+		return nullptr;
+
+	if(s_in_update)
+		return get_entity_from_handle<sdk::C_BaseAttributableItem>(handle);
+
+	// Handles carry the serial, so a reused slot never matches
+	const auto& snapshot = get();
+	for(auto i = 0; i < snapshot.weapon_count; ++i)
+		if(snapshot.weapons[i].handle == handle)
+			return snapshot.weapons[i].entity;
+
+	return get_entity_from_handle<sdk::C_BaseAttributableItem>(handle);
+}
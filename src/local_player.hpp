@@ -0,0 +1,44 @@
+#pragma once
+#include "SDK.hpp"
+
+#include <array>
+
+// The local player and the entities hanging off it, resolved once per frame
+// stage instead of separately by every hook. Entities are only created and
+// deleted while a network update is read, so nothing is cached between
+// begin_network_update and end_network_update: there get() resolves afresh on
+// every call and leaves the weapon list empty, and get_weapon goes to the
+// entity list. Game thread only.
+namespace local_player
+{
+	template <typename T>
+	struct cached_entity
+	{
+		sdk::CBaseHandle handle = sdk::INVALID_EHANDLE_INDEX;
+		T* entity = nullptr;
+	};
+
+	struct snapshot
+	{
+		int index = 0;
+		sdk::C_BasePlayer* player = nullptr;
+		bool alive = false;
+
+		cached_entity<sdk::C_BaseViewModel> view_model;
+		cached_entity<sdk::C_BaseAttributableItem> active_weapon; // The view model's weapon
+
+		std::array<cached_entity<sdk::C_BaseAttributableItem>, sdk::MAX_WEAPONS> weapons;
+		int weapon_count = 0;
+	};
+
+	auto get() -> const snapshot&;
+	auto invalidate() -> void;
+
+	// Called by FrameStageNotify at NET_UPDATE_START and POSTDATAUPDATE_START
+	auto begin_network_update() -> void;
+	auto end_network_update() -> void;
+
+	// From the snapshot if the handle is one of the local player's weapons with
+	// the same serial, else from the entity list
+	auto get_weapon(sdk::CBaseHandle handle) -> sdk::C_BaseAttributableItem*;
+}
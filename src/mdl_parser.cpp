@@ -0,0 +1,184 @@
+#include "mdl_parser.hpp"
+
+#include <cstring>
+
+namespace
+{
+	// Offsets into studiohdr_t
+	enum header_offset : std::size_t
+	{
+		OFFSET_ID = 0,
+		OFFSET_VERSION = 4,
+		OFFSET_CHECKSUM = 8,
+		OFFSET_NAME = 12,
+		OFFSET_LENGTH = 76,
+		OFFSET_FLAGS = 152,
+		OFFSET_NUM_BONES = 156,
+		OFFSET_BONE_INDEX = 160,
+		OFFSET_NUM_LOCAL_SEQ = 188,
+		OFFSET_LOCAL_SEQ_INDEX = 192,
+		OFFSET_NUM_TEXTURES = 204,
+		OFFSET_TEXTURE_INDEX = 208,
+		OFFSET_NUM_CD_TEXTURES = 212,
+		OFFSET_NUM_BODY_PARTS = 232,
+		OFFSET_BODY_PART_INDEX = 236,
+		OFFSET_NUM_INCLUDE_MODELS = 336
+	};
+
+	// Offsets into mstudioseqdesc_t, names are relative to the record
+	enum sequence_offset : std::size_t
+	{
+		OFFSET_SEQ_LABEL_INDEX = 4,
+		OFFSET_SEQ_ACTIVITY_NAME_INDEX = 8,
+		OFFSET_SEQ_FLAGS = 12,
+		OFFSET_SEQ_ACTIVITY_WEIGHT = 20
+	};
+
+	// Record sizes of the tables we check, identical for versions 44-49
+	constexpr std::size_t k_bone_size = 216;
+	constexpr std::size_t k_sequence_size = 212;
+	constexpr std::size_t k_texture_size = 64;
+	constexpr std::size_t k_body_part_size = 16;
+
+	// studio.h limits, anything above these is garbage
+	constexpr int k_max_bones = 256;
+	constexpr int k_max_sequences = 0x10000;
+	constexpr int k_max_textures = 1024;
+	constexpr int k_max_body_parts = 1024;
+
+	auto read_i32(const std::uint8_t* data, const std::size_t offset) -> std::int32_t
+	{
+		std::int32_t value;
+		memcpy(&value, data + offset, sizeof value);
+		return value;
+	}
+
+	// Empty if the string is out of bounds or not terminated
+	auto read_string(const std::uint8_t* data, const std::size_t length, const std::size_t base, const std::int32_t offset) -> std::string
+	{
+		if(offset <= 0 || base + std::size_t(offset) >= length)
+			return {};
+
+		const auto start = reinterpret_cast<const char*>(data + base + std::size_t(offset));
+		const auto end = static_cast<const char*>(memchr(start, '\0', length - base - std::size_t(offset)));
+		return end ? std::string(start, end) : std::string();
+	}
+
+	// The table has to fit inside the length the header claims
+	auto table_in_bounds(const int count, const int index, const std::size_t stride,
+		const int max_count, const std::size_t length) -> bool
+	{
+		if(count < 0 || count > max_count)
+			return false;
+		if(count == 0)
+			return true;
+		if(index < int(mdl::k_header_size))
+			return false;
+		return std::size_t(index) + std::size_t(count) * stride <= length;
+	}
+}
+
+auto mdl::parse_header(const void* data, const std::size_t size, header_info& out) -> parse_status
+{
+	const auto bytes = static_cast<const std::uint8_t*>(data);
+
+	if(!bytes || size < k_header_size)
+		return parse_status::too_small;
+
+	if(std::uint32_t(read_i32(bytes, OFFSET_ID)) != k_studio_magic)
+		return parse_status::bad_magic;
+
+	out.version = read_i32(bytes, OFFSET_VERSION);
+	if(out.version < k_min_version || out.version > k_max_version)
+		return parse_status::unsupported_version;
+
+	out.checksum = read_i32(bytes, OFFSET_CHECKSUM);
+	memcpy(out.name, bytes + OFFSET_NAME, sizeof out.name);
+	out.name[sizeof out.name - 1] = '\0';
+
+	// Some tools pad the file, but the header must never claim more than we have
+	out.length = read_i32(bytes, OFFSET_LENGTH);
+	if(out.length < int(k_header_size) || std::size_t(out.length) > size)
+		return parse_status::truncated;
+
+	const auto length = std::size_t(out.length);
+
+	out.flags = read_i32(bytes, OFFSET_FLAGS);
+
+	out.bone_count = read_i32(bytes, OFFSET_NUM_BONES);
+	if(!table_in_bounds(out.bone_count, read_i32(bytes, OFFSET_BONE_INDEX), k_bone_size, k_max_bones, length))
+		return parse_status::bad_bone_table;
+
+	out.sequence_count = read_i32(bytes, OFFSET_NUM_LOCAL_SEQ);
+	if(!table_in_bounds(out.sequence_count, read_i32(bytes, OFFSET_LOCAL_SEQ_INDEX), k_sequence_size, k_max_sequences, length))
+		return parse_status::bad_sequence_table;
+
+	out.material_count = read_i32(bytes, OFFSET_NUM_TEXTURES);
+	out.material_dir_count = read_i32(bytes, OFFSET_NUM_CD_TEXTURES);
+	if(!table_in_bounds(out.material_count, read_i32(bytes, OFFSET_TEXTURE_INDEX), k_texture_size, k_max_textures, length)
+		|| out.material_dir_count < 0 || out.material_dir_count > k_max_textures)
+		return parse_status::bad_material_table;
+
+	out.body_part_count = read_i32(bytes, OFFSET_NUM_BODY_PARTS);
+	if(!table_in_bounds(out.body_part_count, read_i32(bytes, OFFSET_BODY_PART_INDEX), k_body_part_size, k_max_body_parts, length))
+		return parse_status::bad_body_part_table;
+
+	out.include_model_count = read_i32(bytes, OFFSET_NUM_INCLUDE_MODELS);
+
+	return parse_status::ok;
+}
+
+auto mdl::parse_sequences(const void* data, const std::size_t size, std::vector<sequence_info>& out) -> parse_status
+{
+	out.clear();
+
+	header_info header;
+	const auto status = parse_header(data, size, header);
+	if(status != parse_status::ok)
+		return status;
+
+	const auto bytes = static_cast<const std::uint8_t*>(data);
+	const auto length = std::size_t(header.length);
+	const auto table = std::size_t(read_i32(bytes, OFFSET_LOCAL_SEQ_INDEX));
+
+	out.resize(std::size_t(header.sequence_count));
+	for(auto i = std::size_t(0); i < out.size(); ++i)
+	{
+		const auto record = table + i * k_sequence_size;
+		auto& sequence = out[i];
+		sequence.label = read_string(bytes, length, record, read_i32(bytes, record + OFFSET_SEQ_LABEL_INDEX));
+		sequence.activity = read_string(bytes, length, record, read_i32(bytes, record + OFFSET_SEQ_ACTIVITY_NAME_INDEX));
+		sequence.flags = read_i32(bytes, record + OFFSET_SEQ_FLAGS);
+		sequence.activity_weight = read_i32(bytes, record + OFFSET_SEQ_ACTIVITY_WEIGHT);
+	}
+
+	return parse_status::ok;
+}
+
+auto mdl::get_length(const void* data) -> std::size_t
+{
+	const auto bytes = static_cast<const std::uint8_t*>(data);
+	if(!bytes || std::uint32_t(read_i32(bytes, OFFSET_ID)) != k_studio_magic)
+		return 0;
+
+	const auto length = read_i32(bytes, OFFSET_LENGTH);
+	return length < int(k_header_size) ? 0 : std::size_t(length);
+}
+
+auto mdl::describe(const parse_status status) -> const char*
+{
+	switch(status)
+	{
+	case parse_status::ok: return "valid";
+	case parse_status::io_error: return "the file could not be read";
+	case parse_status::too_small: return "the file is too small to be a model";
+	case parse_status::bad_magic: return "not a studio model (missing IDST header)";
+	case parse_status::unsupported_version: return "unsupported studio model version";
+	case parse_status::truncated: return "the file is truncated";
+	case parse_status::bad_bone_table: return "corrupt bone table";
+	case parse_status::bad_sequence_table: return "corrupt sequence table";
+	case parse_status::bad_material_table: return "corrupt material table";
+	case parse_status::bad_body_part_table: return "corrupt body part table";
+	default: return "unknown error";
+	}
+}
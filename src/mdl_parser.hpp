@@ -0,0 +1,68 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Reader for the studiohdr_t header at the start of every .mdl file. Everything
+// is read with bounds checks from a plain byte buffer, so this has no game or
+// Windows dependencies and can be built and tried on any platform.
+namespace mdl
+{
+	constexpr std::uint32_t k_studio_magic = 0x54534449; // "IDST"
+	constexpr int k_min_version = 44;
+	constexpr int k_max_version = 49;
+
+	// sizeof(studiohdr_t) for versions 44-49
+	constexpr std::size_t k_header_size = 408;
+
+	enum class parse_status
+	{
+		ok,
+		io_error,
+		too_small,
+		bad_magic,
+		unsupported_version,
+		truncated,
+		bad_bone_table,
+		bad_sequence_table,
+		bad_material_table,
+		bad_body_part_table
+	};
+
+	struct header_info
+	{
+		int version = 0;
+		std::int32_t checksum = 0;
+		char name[64] = "";
+		int length = 0;
+		int flags = 0;
+		int bone_count = 0;
+		int sequence_count = 0;
+		int material_count = 0;
+		int material_dir_count = 0;
+		int body_part_count = 0;
+		int include_model_count = 0;
+	};
+
+	// One mstudioseqdesc_t of the local sequence table
+	struct sequence_info
+	{
+		std::string label;
+		std::string activity; // Empty if the sequence has no activity
+		int activity_weight = 0;
+		int flags = 0;
+	};
+
+	auto parse_header(const void* data, std::size_t size, header_info& out) -> parse_status;
+
+	// Sequences in the order of their indices. Sequences pulled in with
+	// $includemodel aren't in the file and can't be listed.
+	auto parse_sequences(const void* data, std::size_t size, std::vector<sequence_info>& out) -> parse_status;
+
+	// The length a studio header in memory claims, 0 if it isn't one. For
+	// headers owned by the engine, whose buffer size we don't know.
+	auto get_length(const void* data) -> std::size_t;
+
+	auto describe(parse_status status) -> const char*;
+}
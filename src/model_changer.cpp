@@ -1,10 +1,24 @@
 #include "model_changer.hpp"
+#include "model_validator.hpp"
+#include "file_indexer.hpp"
+#include "frame_scheduler.hpp"
+#include "model_index_cache.hpp"
+#include "nSkinz.hpp"
+#include "profiler.hpp"
 #include "SDK.hpp"
+#include "Utilities/jobs.hpp"
+#include "Utilities/parallel.hpp"
 
+#include <chrono>
 #include <cstdio>
 #include <cstring>
+#include <filesystem>
 #include <fstream>
+#include <iterator>
 #include <algorithm>
+#include <mutex>
+#include <future>
+#include <unordered_map>
 #include <stdexcept>
 #include <utility>
 #include <nlohmann/json.hpp>
@@ -15,13 +29,15 @@ using json = nlohmann::json;
 namespace model_changer
 {
 	std::vector<model_replacement> g_replacements;
+	std::recursive_mutex g_rules_mutex;
 	bool g_enabled = true;
 	bool g_enable_custom_sounds = true;
-	std::vector<std::string> g_installed_models;
-	bool g_models_scanned = false;
+	bool g_lazy_precache = false;
+	int g_model_budget_mb = 0;
+	std::shared_ptr<const std::vector<std::string>> g_installed_models = std::make_shared<const std::vector<std::string>>();
+	std::atomic<bool> g_models_scanned{ false };
 	std::string g_models_root;
-	operation_status g_last_operation_status = operation_status::none;
-	std::string g_last_operation_message = "Ready.";
+	std::atomic<operation_status> g_last_operation_status{ operation_status::none };
 	bool g_hook_active = false;
 	const char* g_hook_status = "Not initialized";
 	bool g_svpure_bypassed = false;
@@ -31,10 +47,43 @@ namespace model_changer
 // Interface pointers (defined in nSkinz.cpp)
 extern IMDLCache* g_mdl_cache;
 
+// Written by the menu too, so atomic
+static std::atomic<unsigned> g_rules_generation{ 0 };
+
+// Scans finish on background threads, so the message is guarded
+static std::mutex g_last_operation_mutex;
+static std::string g_last_operation_message = "Ready.";
+
 static void set_operation(model_changer::operation_status status, const std::string& message)
 {
+	std::lock_guard<std::mutex> lock(g_last_operation_mutex);
 	model_changer::g_last_operation_status = status;
-	model_changer::g_last_operation_message = message;
+	g_last_operation_message = message;
+}
+
+auto model_changer::get_last_operation_message() -> std::string
+{
+	std::lock_guard<std::mutex> lock(g_last_operation_mutex);
+	return g_last_operation_message;
+}
+
+static std::string get_game_dir()
+{
+	char exe_path[MAX_PATH];
+	if (GetModuleFileNameA(nullptr, exe_path, MAX_PATH) == 0)
+		return {};
+	std::string game_dir = exe_path;
+	auto last_slash = game_dir.find_last_of("\\/");
+	if (last_slash != std::string::npos) game_dir = game_dir.substr(0, last_slash + 1);
+	return game_dir;
+}
+
+static const char* model_basename(const char* path)
+{
+	const auto slash = strrchr(path, '/');
+	const auto backslash = strrchr(path, '\\');
+	const auto separator = !slash ? backslash : (!backslash || slash > backslash ? slash : backslash);
+	return separator ? separator + 1 : path;
 }
 
 template <size_t Size>
@@ -75,40 +124,12 @@ public:
 
 static CNetworkStringTableContainer* g_string_table_container = nullptr;
 
-static std::vector<std::string> g_custom_sounds_list;
-static bool g_custom_sounds_scanned = false;
+// Indexes are persisted beside the configs so rescans after a restart stay incremental
+static file_indexer::indexer g_model_index({ ".mdl" }, "models/", "nSkinz_model_index.json");
+static file_indexer::indexer g_sound_index({ ".wav", ".mp3" }, "custom/", "nSkinz_sound_index.json");
 
 static bool patch_mdl_internal_name(const char* original, const char* replacement);
-
-static void scan_sounds_directory(const std::string& base_path, const std::string& relative_path, std::vector<std::string>& results)
-{
-	WIN32_FIND_DATAA find_data;
-	HANDLE h_find = FindFirstFileA((base_path + relative_path + "*").c_str(), &find_data);
-	if (h_find == INVALID_HANDLE_VALUE) return;
-
-	do
-	{
-		const std::string name = find_data.cFileName;
-		if (name == "." || name == "..") continue;
-
-		if ((find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-			&& !(find_data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT))
-			scan_sounds_directory(base_path, relative_path + name + "\\", results);
-		else if (name.length() > 4)
-		{
-			std::string ext = name.substr(name.length() - 4);
-			std::transform(ext.begin(), ext.end(), ext.begin(),
-				[](unsigned char c) { return (char)std::tolower(c); });
-			if (ext == ".wav" || ext == ".mp3")
-			{
-				std::string rel = relative_path + name;
-				std::replace(rel.begin(), rel.end(), '\\', '/');
-				results.push_back("custom/" + rel);
-			}
-		}
-	} while (FindNextFileA(h_find, &find_data));
-	FindClose(h_find);
-}
+static bool patch_model_once(const char* original, const char* replacement, unsigned batch);
 
 // ========================================================
 // Raw VMT Hook for FindMDL
@@ -121,39 +142,61 @@ static DWORD* g_mdl_custom_vmt = nullptr;
 static DWORD* g_mdl_instance = nullptr;
 static int g_mdl_vmt_size = 0;
 
-MDLHandle_t __fastcall hkFindMDL(void* ecx, void* edx, char* FilePath)
+// Set while the custom sounds are being added, so FindMDL doesn't queue them twice
+static std::atomic<bool> g_sound_precache_queued{ false };
+
+// Sounds added per scheduler slice, four strings each
+static constexpr std::size_t k_sounds_per_slice = 16;
+
+// Adds every custom sound to the precache table a few at a time instead of in
+// one burst, hundreds of them are enough for a visible hitch
+static void queue_sound_precache()
 {
-	if (model_changer::g_enable_custom_sounds && g_string_table_container)
+	if (g_sound_precache_queued.exchange(true))
+		return;
+
+	frame_scheduler::post(frame_scheduler::priority::normal, "precache sounds", [next = std::size_t(0)]() mutable
 	{
-		if (!g_custom_sounds_scanned)
+		const auto custom_sounds = g_sound_index.get_files();
+		auto* sound_table = g_string_table_container->FindTable("soundprecache");
+		if (!sound_table)
 		{
-			char exe_path[MAX_PATH];
-			GetModuleFileNameA(nullptr, exe_path, MAX_PATH);
-			std::string game_dir = exe_path;
-			auto last_slash = game_dir.find_last_of("\\/");
-			if (last_slash != std::string::npos) game_dir = game_dir.substr(0, last_slash + 1);
-
-			std::string sounds_dir = game_dir + "csgo\\sound\\custom\\";
-			scan_sounds_directory(sounds_dir, "", g_custom_sounds_list);
-			g_custom_sounds_scanned = true;
+			g_sound_precache_queued = false;
+			return true;
 		}
 
-		if (!g_custom_sounds_list.empty())
+		const auto end = (std::min)(next + k_sounds_per_slice, custom_sounds->size());
+		for (; next < end; ++next)
+		{
+			const auto& snd = (*custom_sounds)[next];
+			sound_table->AddString(false, snd.c_str());
+			sound_table->AddString(false, (std::string(")") + snd).c_str());
+			sound_table->AddString(false, (std::string("*") + snd).c_str());
+			sound_table->AddString(false, (std::string("*)") + snd).c_str());
+		}
+
+		if (next < custom_sounds->size())
+			return false;
+
+		g_sound_precache_queued = false;
+		return true;
+	});
+}
+
+// Timed together with the engine's FindMDL, which can load the model
+MDLHandle_t __fastcall hkFindMDL(void* ecx, void* edx, char* FilePath)
+{
+	profiler::scoped_timer timer(profiler::hook_id::find_mdl);
+
+	if (model_changer::g_enable_custom_sounds && g_string_table_container)
+	{
+		// The sound index is built on a worker at startup; until it's published the list is empty
+		const auto custom_sounds = g_sound_index.get_files();
+		if (!custom_sounds->empty())
 		{
 			auto* sound_table = g_string_table_container->FindTable("soundprecache");
-			if (sound_table)
-			{
-				if (sound_table->FindStringIndex(g_custom_sounds_list[0].c_str()) == ((int)-1))
-				{
-					for (const auto& snd : g_custom_sounds_list)
-					{
-						sound_table->AddString(false, snd.c_str());
-						sound_table->AddString(false, (std::string(")") + snd).c_str());
-						sound_table->AddString(false, (std::string("*") + snd).c_str());
-						sound_table->AddString(false, (std::string("*)") + snd).c_str());
-					}
-				}
-			}
+			if (sound_table && sound_table->FindStringIndex(custom_sounds->front().c_str()) == ((int)-1))
+				queue_sound_precache();
 		}
 	}
 
@@ -165,9 +208,10 @@ MDLHandle_t __fastcall hkFindMDL(void* ecx, void* edx, char* FilePath)
 			{
 				if (strstr(FilePath, rule.original))
 				{
+					// Waits for a worker patching the same file, the engine reads it next
 					if (!rule.is_patched)
 					{
-						patch_mdl_internal_name(rule.original, rule.replacement);
+						patch_model_once(rule.original, rule.replacement, 0);
 						rule.is_patched = true;
 					}
 
@@ -194,8 +238,11 @@ static DWORD* g_snd_instance = nullptr;
 
 static std::unordered_map<std::string, std::string> g_sound_cache;
 
+// Timed together with the engine's EmitSound
 void __fastcall hkEmitSound1(void* ecx, void* edx, void* filter, int iEntIndex, int iChannel, const char* pSoundEntry, unsigned int nSoundEntryHash, const char* pSample, float flVolume, int iSoundLevel, int nSeed, int iFlags, int iPitch, const void* pOrigin, const void* pDirection, void* pUtlVecOrigins, bool bUpdatePositions, float soundtime, int speakerentity, int unk)
 {
+	profiler::scoped_timer timer(profiler::hook_id::emit_sound);
+
 	if (model_changer::g_enabled && model_changer::g_enable_custom_sounds && pSample)
 	{
 		std::string sample = pSample;
@@ -276,17 +323,10 @@ void __fastcall hkEmitSound1(void* ecx, void* edx, void* filter, int iEntIndex,
 				// Filename fuzzy matching to allow arbitrary directory structures like `custom/weapons/m4a1_s/m4a1_silencer_01.wav`
 				if (GetFileAttributesA(full_path.c_str()) == INVALID_FILE_ATTRIBUTES)
 				{
-					if (!g_custom_sounds_scanned)
-					{
-						std::string sounds_dir = game_dir + "csgo\\sound\\custom\\";
-						scan_sounds_directory(sounds_dir, "", g_custom_sounds_list);
-						g_custom_sounds_scanned = true;
-					}
-
 					auto last_slash_idx = bare_sample.find_last_of("/\\");
 					std::string just_filename = (last_slash_idx != std::string::npos) ? bare_sample.substr(last_slash_idx + 1) : bare_sample;
 
-					for (const auto& scanned : g_custom_sounds_list)
+					for (const auto& scanned : *g_sound_index.get_files())
 					{
 						if (scanned.length() >= just_filename.length())
 						{
@@ -351,7 +391,7 @@ void __fastcall hkEmitSound1(void* ecx, void* edx, void* filter, int iEntIndex,
 					// If not local player, play the original default sound natively in 3D
 					return g_original_emit_sound(ecx, filter, iEntIndex, iChannel, pSoundEntry, nSoundEntryHash, pSample, flVolume, iSoundLevel, nSeed, iFlags, iPitch, pOrigin, pDirection, pUtlVecOrigins, bUpdatePositions, soundtime, speakerentity, unk);
 				}
-				else
+				else if (g_sound_index.is_ready())
 				{
 					g_sound_cache[sample] = ""; // Not found on disk
 				}
@@ -496,8 +536,9 @@ static bool patch_mdl_internal_name(const char* original, const char* replacemen
 		return false;
 	}
 
-	// Verify it's an MDL
-	if (file_data.size() < 4 || *reinterpret_cast<uint32_t*>(file_data.data()) != 0x54534449)
+	// Verify it's an MDL with sane tables before writing anything back
+	mdl::header_info header;
+	if (mdl::parse_header(file_data.data(), file_data.size(), header) != mdl::parse_status::ok)
 	{
 		return false;
 	}
@@ -515,22 +556,636 @@ static bool patch_mdl_internal_name(const char* original, const char* replacemen
 
 	if (patched_count > 0)
 	{
-		if (fopen_s(&f, full_path.c_str(), "wb") == 0 && f)
+		// Written next to it and renamed over it, so nothing ever reads half a file
+		const auto temp_path = full_path + ".nskinz";
+		if (fopen_s(&f, temp_path.c_str(), "wb") != 0 || !f)
+			return false;
+
+		const auto written = fwrite(file_data.data(), 1, file_data.size(), f);
+		const auto closed = fclose(f) == 0;
+		if (written != file_data.size() || !closed
+			|| !MoveFileExA(temp_path.c_str(), full_path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
 		{
-			fwrite(file_data.data(), 1, file_data.size(), f);
-			fclose(f);
+			DeleteFileA(temp_path.c_str());
+			return false;
 		}
+	}
+
+	return true;
+}
+
+// Patching rewrites the replacement .mdl, so every thread that patches or
+// reads it for loading goes through the file's guard. Keyed by the normalized
+// replacement path, never erased so references stay valid.
+struct patch_guard
+{
+	std::mutex mutex;
+	unsigned batch = 0; // Last batch that patched it, 0 if none did yet
+	bool patched = false;
+};
+
+static std::mutex g_patch_guards_mutex;
+static std::unordered_map<std::string, std::unique_ptr<patch_guard>> g_patch_guards;
+
+static patch_guard& get_patch_guard(const char* replacement)
+{
+	std::lock_guard<std::mutex> lock(g_patch_guards_mutex);
+	auto& guard = g_patch_guards[model_validator::normalize_path(replacement)];
+	if (!guard)
+		guard = std::make_unique<patch_guard>();
+	return *guard;
+}
+
+// With the file's guard held. Patches once per batch; batch 0 is FindMDL,
+// which only patches files no batch has patched yet.
+static bool patch_locked(patch_guard& guard, const char* original, const char* replacement, const unsigned batch)
+{
+	if (guard.batch != 0 && (batch == 0 || guard.batch == batch))
+		return guard.patched;
+
+	guard.patched = patch_mdl_internal_name(original, replacement);
+	guard.batch = batch ? batch : ~0u;
+	return guard.patched;
+}
+
+static bool patch_model_once(const char* original, const char* replacement, const unsigned batch)
+{
+	auto& guard = get_patch_guard(replacement);
+	std::lock_guard<std::mutex> lock(guard.mutex);
+	return patch_locked(guard, original, replacement, batch);
+}
+
+// Apply is split in two stages. Validating and patching the .mdl files only
+// touches the disk and runs on worker threads; the string table and MDLCache
+// calls have to happen on the game thread and run as frame scheduler tasks,
+// one per model within the per-frame budget, so applying many rules no longer
+// stalls a single frame.
+//
+// Work arrives in batches: Apply from the menu, the rules loaded when a map
+// starts, and in lazy mode single rules requested when their weapon shows up.
+// Batches that overlap are merged into one run and reported together.
+
+enum class precache_reason
+{
+	apply,
+	map_start,
+	on_demand,
+	reload,
+	config_reload
+};
+
+struct precache_job
+{
+	std::size_t rule_index = 0;
+	std::string original;
+	std::string replacement;
+	precache_reason reason = precache_reason::apply;
+	int generation = 0;
+	unsigned batch = 0;
+	model_validator::result validation;
+	bool is_patched = false;
+	double disk_ms = 0.0;
+};
+
+struct precache_batch
+{
+	precache_reason reason = precache_reason::apply;
+	int enabled = 0;
+	int incomplete = 0;
+	int queued = 0;
+};
+
+// Game thread only
+struct precache_progress
+{
+	bool has_apply = false;
+	bool has_map_start = false;
+	bool has_config_reload = false;
+	int enabled = 0;
+	int incomplete = 0;
+	int queued = 0;
+	int completed = 0;
+	int applied = 0;
+	int failed = 0;
+	int invalid = 0;
+	int recovered = 0;
+	int frames = 0;
+	double disk_ms = 0.0;
+	double engine_ms = 0.0;
+	double slowest_ms = 0.0;
+	std::string slowest;
+	std::string first_invalid;
+	std::chrono::steady_clock::time_point start;
+};
+
+struct precache_worker
+{
+	std::future<void> job;
+};
+
+static std::mutex g_precache_mutex;
+static std::vector<precache_batch> g_precache_batches;
+static std::vector<precache_worker> g_precache_workers;
+static model_changer::precache_stats g_precache_stats;
+
+// Bumped when queued work becomes stale, e.g. the map was unloaded
+static std::atomic<int> g_precache_generation{ 0 };
+static unsigned g_precache_batch_id = 0; // Game thread only
+static std::atomic<bool> g_precache_active{ false };
+
+static precache_progress g_precache_progress;
+static bool g_precache_worked = false;
+static bool g_map_loaded = false;
+static INetworkStringTable* g_map_precache_table = nullptr; // What the loaded map was seen with
+static std::string g_map_level_name;
+static std::chrono::steady_clock::time_point g_map_start;
+// Residency: every custom model loaded on this map, by replacement path. Models
+// are released through MDLCache when their rule is disabled or when the budget
+// is exceeded, least recently used first. Their precache string and model index
+// stay valid, so the next use brings them back through the queue.
+struct resident_model
+{
+	MDLHandle_t handle = MDLHANDLE_INVALID;
+	std::uint64_t bytes = 0;
+	std::chrono::steady_clock::time_point last_used;
+	bool resident = false;
+};
+
+// Models used this recently are never evicted. The held weapon is touched every
+// update, models drawn on any entity at every budget check.
+static constexpr double k_model_hot_seconds = 5.0;
+
+static std::unordered_map<std::string, resident_model> g_resident_models;
+static std::vector<model_changer::resident_model_info> g_resident_models_snapshot;
+static std::chrono::steady_clock::time_point g_last_residency_check;
+
+static double elapsed_ms(std::chrono::steady_clock::time_point since)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+static bool is_rule_complete(const model_replacement& rule)
+{
+	return rule.original[0] != '\0' && rule.replacement[0] != '\0';
+}
+
+static void join_precache_workers(bool finished_only)
+{
+	std::vector<precache_worker> workers;
+	{
+		std::lock_guard<std::mutex> lock(g_precache_mutex);
+		for (auto it = g_precache_workers.begin(); it != g_precache_workers.end();)
+		{
+			if (!finished_only || it->job.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+			{
+				workers.push_back(std::move(*it));
+				it = g_precache_workers.erase(it);
+			}
+			else
+				++it;
+		}
+	}
+
+	for (auto& worker : workers)
+		worker.job.wait();
+}
+
+// Disk stage, on workers
+static void prepare_precache_job(precache_job& job, const std::string& content_dir)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	// Jobs of a batch can share a replacement, the guard keeps them from
+	// validating it while another one patches it
+	auto& guard = get_patch_guard(job.replacement.c_str());
+	std::lock_guard<std::mutex> lock(guard.mutex);
+
+	// Handing a broken studiohdr to the engine can crash it, so check it first.
+	// This also reads the whole file, so the engine's load below hits the OS cache.
+	job.validation = model_validator::validate_file(content_dir, job.replacement);
+
+	// Patch the internal names inside the custom .mdl so it doesn't conflict with VPK
+	if (job.validation.is_valid())
+		job.is_patched = patch_locked(guard, job.original.c_str(), job.replacement.c_str(), job.batch);
+
+	job.disk_ms = elapsed_ms(start);
+}
+
+static void load_ready_job(const precache_job& job);
+
+// Game thread, the only one that starts batches or clears them. Queues the
+// disk stage and announces the batch to run_precache_queue.
+static void start_precache(std::vector<precache_job> jobs, precache_batch batch)
+{
+	join_precache_workers(true);
+
+	const auto generation = g_precache_generation.load();
+	if (++g_precache_batch_id == 0)
+		++g_precache_batch_id;
+	for (auto& job : jobs)
+	{
+		job.reason = batch.reason;
+		job.generation = generation;
+		job.batch = g_precache_batch_id;
+	}
+	batch.queued = static_cast<int>(jobs.size());
+
+	std::lock_guard<std::mutex> lock(g_precache_mutex);
+	g_precache_batches.push_back(batch);
+	g_precache_active = true;
+
+	if (jobs.empty())
+		return;
+
+	auto job = jobs::submit([jobs = std::move(jobs), content_dir = get_game_dir() + "csgo\\"]() mutable
+	{
+		parallel::for_each_index(jobs.size(), [&](const std::size_t i)
+		{
+			if (jobs[i].generation != g_precache_generation)
+				return;
+
+			prepare_precache_job(jobs[i], content_dir);
+
+			// A model showing up right now goes ahead of bulk loads
+			const auto level = jobs[i].reason == precache_reason::on_demand || jobs[i].reason == precache_reason::reload
+				? frame_scheduler::priority::high : frame_scheduler::priority::normal;
+			frame_scheduler::post(level, "load model", [job = std::move(jobs[i])]
+			{
+				load_ready_job(job);
+				return true;
+			});
+		});
+	});
+	g_precache_workers.push_back({ std::move(job) });
+}
+
+// Engine stage, on the game thread. Returns the model index or -1.
+static int load_precache_job(const precache_job& job, INetworkStringTable* precache_table, bool& recovered, MDLHandle_t& loaded_handle)
+{
+	const auto path = job.replacement.c_str();
+
+	// Add the path once; adding duplicates needlessly grows the network string table.
+	if (precache_table->FindStringIndex(path) == -1)
+		precache_table->AddString(false, path);
+
+	// A failed load is sticky in MDLCache004. The fuller interface from the
+	// reference implementation lets us reset and retry that cached error.
+	auto handle = g_original_find_mdl
+		? g_original_find_mdl(g_mdl_cache, const_cast<char*>(path))
+		: g_mdl_cache->FindMDL(path);
+	bool is_error_model = handle == MDLHANDLE_INVALID || g_mdl_cache->IsErrorModel(handle);
+	if (is_error_model && handle != MDLHANDLE_INVALID && g_mdl_vmt_size > 47)
+	{
+		g_mdl_cache->ResetErrorModelStatus(handle);
+		handle = g_original_find_mdl
+			? g_original_find_mdl(g_mdl_cache, const_cast<char*>(path))
+			: g_mdl_cache->FindMDL(path);
+		is_error_model = handle == MDLHANDLE_INVALID || g_mdl_cache->IsErrorModel(handle);
+		recovered = !is_error_model;
+	}
+
+	if (!is_error_model && g_mdl_vmt_size > 46)
+		g_mdl_cache->PreloadModel(handle);
+
+	// Force the engine to load the model into memory first
+	g_model_info->FindOrLoadModel(path);
+
+	loaded_handle = is_error_model ? MDLHANDLE_INVALID : handle;
+
+	const auto index = g_model_info->GetModelIndex(path);
+	return !is_error_model && index > 0 ? index : -1;
+}
+
+static void publish_residency()
+{
+	const auto now = std::chrono::steady_clock::now();
+
+	model_changer::precache_stats totals;
+	std::vector<model_changer::resident_model_info> models;
+	models.reserve(g_resident_models.size());
+	for (const auto& entry : g_resident_models)
+	{
+		const auto& model = entry.second;
+		if (model.resident)
+		{
+			++totals.resident_models;
+			totals.resident_bytes += model.bytes;
+		}
+
+		model_changer::resident_model_info info;
+		info.path = entry.first;
+		info.bytes = model.bytes;
+		info.idle_seconds = std::chrono::duration<double>(now - model.last_used).count();
+		info.resident = model.resident;
+		models.push_back(std::move(info));
+	}
+
+	std::sort(models.begin(), models.end(), [](const auto& left, const auto& right)
+	{
+		return left.idle_seconds < right.idle_seconds;
+	});
+
+	std::lock_guard<std::mutex> lock(g_precache_mutex);
+	g_precache_stats.resident_models = totals.resident_models;
+	g_precache_stats.resident_bytes = totals.resident_bytes;
+	g_resident_models_snapshot = std::move(models);
+}
+
+static bool is_model_wanted(const std::string& path)
+{
+	if (!model_changer::g_enabled)
+		return false;
+
+	for (const auto& rule : model_changer::g_replacements)
+		if (rule.enabled && path == rule.replacement)
+			return true;
+	return false;
+}
+
+static void evict_model(const std::string& path, resident_model& model)
+{
+	// Never pass IGNORELOCK, the renderer may hold the data this frame
+	if (model.handle != MDLHANDLE_INVALID && g_mdl_vmt_size > 26)
+		g_mdl_cache->Flush(model.handle, MDLCACHE_FLUSH_ALL & ~MDLCACHE_FLUSH_IGNORELOCK);
+
+	model.resident = false;
+
+	// Allow touch_model to queue the reload
+	for (auto& rule : model_changer::g_replacements)
+		if (path == rule.replacement)
+			rule.is_requested = false;
+
+	std::lock_guard<std::mutex> lock(g_precache_mutex);
+	++g_precache_stats.evictions;
+}
+
+static void touch_model(model_replacement& rule);
+
+// Model index to the rule whose replacement it draws, -1 for none. Other
+// players' models resolve through FindMDL by their original path, so they're
+// matched by name the same way. Rebuilt when the rules or the level change.
+static std::unordered_map<unsigned, int> g_rule_by_model_index;
+static unsigned g_rule_by_model_index_rules = ~0u;
+static unsigned g_rule_by_model_index_level = ~0u;
+
+static int find_rule_for_model(const unsigned model_index)
+{
+	const auto it = g_rule_by_model_index.find(model_index);
+	if (it != g_rule_by_model_index.end())
+		return it->second;
+
+	auto rule_index = -1;
+	const auto model = g_model_info->GetModel(static_cast<int>(model_index));
+	const auto name = model ? g_model_info->GetModelName(model) : nullptr;
+	if (name)
+	{
+		for (std::size_t i = 0; i < model_changer::g_replacements.size(); ++i)
+		{
+			const auto& rule = model_changer::g_replacements[i];
+			if (rule.enabled && is_rule_complete(rule)
+				&& (strstr(name, rule.original) || strcmp(name, rule.replacement) == 0))
+			{
+				rule_index = static_cast<int>(i);
+				break;
+			}
+		}
+	}
+
+	g_rule_by_model_index.emplace(model_index, rule_index);
+	return rule_index;
+}
+
+// Game thread. Every entity drawing a replacement keeps it resident, not only
+// the local player's weapons that go through get_replacement_index.
+static void touch_models_in_use()
+{
+	if (!g_entity_list || !g_model_info)
+		return;
+
+	const auto rules_generation = model_changer::get_rules_generation();
+	const auto level_generation = g_level_generation.load();
+	if (rules_generation != g_rule_by_model_index_rules || level_generation != g_rule_by_model_index_level)
+	{
+		g_rule_by_model_index.clear();
+		g_rule_by_model_index_rules = rules_generation;
+		g_rule_by_model_index_level = level_generation;
+	}
+
+	const auto highest = g_entity_list->GetHighestEntityIndex();
+	for (auto i = 1; i <= highest; ++i)
+	{
+		const auto entity = static_cast<sdk::C_BaseEntity*>(g_entity_list->GetClientEntity(i));
+		if (!entity || entity->IsDormant())
+			continue;
+
+		const auto rule_index = find_rule_for_model(entity->GetModelIndex());
+		if (rule_index >= 0)
+			touch_model(model_changer::g_replacements[rule_index]);
+	}
+}
+
+// Game thread, about once a second
+static void enforce_model_budget()
+{
+	const auto now = std::chrono::steady_clock::now();
+	if (now - g_last_residency_check < std::chrono::seconds(1))
+		return;
+	g_last_residency_check = now;
+
+	touch_models_in_use();
+
+	std::uint64_t resident_bytes = 0;
+	for (auto& entry : g_resident_models)
+	{
+		if (!entry.second.resident)
+			continue;
+
+		if (is_model_wanted(entry.first))
+			resident_bytes += entry.second.bytes;
 		else
+			evict_model(entry.first, entry.second);
+	}
+
+	const auto budget = std::uint64_t(model_changer::g_model_budget_mb) * 1024 * 1024;
+	while (budget > 0 && resident_bytes > budget)
+	{
+		auto coldest = g_resident_models.end();
+		for (auto it = g_resident_models.begin(); it != g_resident_models.end(); ++it)
 		{
-			return false;
+			if (!it->second.resident
+				|| std::chrono::duration<double>(now - it->second.last_used).count() < k_model_hot_seconds)
+				continue;
+			if (coldest == g_resident_models.end() || it->second.last_used < coldest->second.last_used)
+				coldest = it;
 		}
+
+		// Everything left is in use, stay over budget rather than thrash
+		if (coldest == g_resident_models.end())
+			break;
+
+		resident_bytes -= coldest->second.bytes;
+		evict_model(coldest->first, coldest->second);
 	}
 
-	return true;
+	publish_residency();
 }
 
-auto model_changer::precache_models() -> void
+static void finish_precache()
+{
+	const auto& progress = g_precache_progress;
+	const auto run_ms = elapsed_ms(progress.start);
+
+	if (progress.has_map_start)
+	{
+		std::lock_guard<std::mutex> lock(g_precache_mutex);
+		g_precache_stats.map_load_ms = elapsed_ms(g_map_start);
+	}
+
+	char summary[320];
+	if (progress.has_apply)
+		snprintf(summary, sizeof(summary), "Applied %d of %d enabled rules in %.0f ms", progress.applied, progress.enabled, run_ms);
+	else if (progress.has_map_start)
+		snprintf(summary, sizeof(summary), "Loaded %d of %d rules for this map in %.0f ms", progress.applied, progress.enabled, run_ms);
+	else if (progress.has_config_reload)
+		snprintf(summary, sizeof(summary), "Loaded %d of %d changed rules from nSkinz_models.json in %.0f ms", progress.applied, progress.enabled, run_ms);
+	else
+		snprintf(summary, sizeof(summary), "Loaded %d model%s on demand in %.0f ms", progress.applied, progress.applied == 1 ? "" : "s", run_ms);
+	std::string message = summary;
+
+	snprintf(summary, sizeof(summary), " (disk %.0f ms on workers, engine %.0f ms over %d frames",
+		progress.disk_ms, progress.engine_ms, progress.frames);
+	message += summary;
+	if (!progress.slowest.empty())
+	{
+		snprintf(summary, sizeof(summary), "; slowest %s %.1f ms", model_basename(progress.slowest.c_str()), progress.slowest_ms);
+		message += summary;
+	}
+	message += ")";
+	if (progress.incomplete > 0)
+		message += "; " + std::to_string(progress.incomplete) + " incomplete";
+	if (progress.failed > 0)
+		message += "; " + std::to_string(progress.failed) + " failed to load";
+	if (progress.invalid > 0)
+		message += "; skipped " + std::to_string(progress.invalid) + " invalid (" + progress.first_invalid + ")";
+	if (progress.recovered > 0)
+		message += "; recovered " + std::to_string(progress.recovered) + " cached error model";
+	message += ".";
+
+	const auto status = progress.failed == 0 && progress.incomplete == 0 && progress.invalid == 0 ? model_changer::operation_status::success
+		: (progress.applied > 0 ? model_changer::operation_status::warning : model_changer::operation_status::error);
+	set_operation(status, message);
+
+	// Refresh the current view models. Loads that don't come from the menu are
+	// picked up by the next PostDataUpdate instead.
+	if (progress.has_apply && status != model_changer::operation_status::error && g_engine)
+		g_engine->ClientCmd_Unrestricted("record x;stop");
+}
+
+// Game thread. Model indices don't survive a map change.
+static void on_map_unloaded()
+{
+	g_map_loaded = false;
+	++g_precache_generation;
+
+	// Jobs of the cleared batches are stale now and never complete, the run
+	// has to end with them
+	const auto was_active = g_precache_active.load();
+	{
+		std::lock_guard<std::mutex> lock(g_precache_mutex);
+		g_precache_batches.clear();
+		g_precache_stats = model_changer::precache_stats();
+		g_precache_active = false;
+	}
+
+	if (was_active)
+		set_operation(model_changer::operation_status::error, "Precaching stopped: the map was unloaded while models were loading.");
+	g_precache_progress = precache_progress();
+	g_precache_worked = false;
+	g_resident_models.clear();
+	g_resident_models_snapshot.clear();
+
+	for (auto& rule : model_changer::g_replacements)
+	{
+		rule.precached_index = -1;
+		rule.is_requested = false;
+	}
+	model_changer::mark_rules_changed();
+	model_index_cache::invalidate();
+	++g_level_generation;
+}
+
+// Game thread. Eager mode loads every enabled rule, lazy mode only the prefetch list.
+static void on_map_loaded()
 {
+	g_map_loaded = true;
+	g_map_start = std::chrono::steady_clock::now();
+	model_index_cache::invalidate();
+	++g_level_generation;
+
+	if (!model_changer::g_enabled)
+		return;
+
+	precache_batch batch;
+	batch.reason = precache_reason::map_start;
+
+	std::vector<precache_job> jobs;
+	for (std::size_t i = 0; i < model_changer::g_replacements.size(); ++i)
+	{
+		auto& rule = model_changer::g_replacements[i];
+		if (!rule.enabled || (model_changer::g_lazy_precache && !rule.prefetch))
+			continue;
+
+		++batch.enabled;
+		if (!is_rule_complete(rule))
+		{
+			++batch.incomplete;
+			continue;
+		}
+
+		rule.is_requested = true;
+
+		precache_job job;
+		job.rule_index = i;
+		job.original = rule.original;
+		job.replacement = rule.replacement;
+		jobs.push_back(std::move(job));
+	}
+
+	if (batch.enabled > 0)
+		start_precache(std::move(jobs), batch);
+}
+
+auto model_changer::is_precaching() -> bool
+{
+	return g_precache_active;
+}
+
+auto model_changer::get_resident_models() -> std::vector<resident_model_info>
+{
+	std::lock_guard<std::mutex> lock(g_precache_mutex);
+	return g_resident_models_snapshot;
+}
+
+auto model_changer::get_precache_stats() -> precache_stats
+{
+	std::lock_guard<std::mutex> lock(g_precache_mutex);
+	auto stats = g_precache_stats;
+	stats.lazy = g_lazy_precache;
+	return stats;
+}
+
+// Game thread, posted by precache_models
+static void start_apply()
+{
+	using model_changer::g_replacements;
+	using model_changer::mark_rules_changed;
+	using model_changer::operation_status;
+
+	if (g_precache_active)
+	{
+		set_operation(operation_status::warning, "Apply is already in progress.");
+		return;
+	}
 	if (!g_string_table_container)
 	{
 		set_operation(operation_status::error, "Apply failed: model precache table interface is unavailable.");
@@ -542,108 +1197,319 @@ auto model_changer::precache_models() -> void
 		return;
 	}
 
-	auto* precache_table = g_string_table_container->FindTable("modelprecache");
-	if (!precache_table)
+	if (!g_string_table_container->FindTable("modelprecache"))
 	{
 		set_operation(operation_status::error, "Apply failed: modelprecache is not available until a map is loaded.");
 		return;
 	}
 
-	int enabled_count = 0;
-	int applied_count = 0;
-	int incomplete_count = 0;
-	int failed_count = 0;
-	int recovered_count = 0;
+	precache_batch batch;
+	batch.reason = precache_reason::apply;
 
-	for (auto& rule : g_replacements)
+	std::vector<precache_job> jobs;
+	for (std::size_t i = 0; i < g_replacements.size(); ++i)
 	{
+		auto& rule = g_replacements[i];
 		if (!rule.enabled)
 			continue;
 
-		++enabled_count;
+		++batch.enabled;
 		rule.precached_index = -1;
-		if (rule.original[0] == '\0' || rule.replacement[0] == '\0')
+		mark_rules_changed();
+		if (!is_rule_complete(rule))
 		{
-			++incomplete_count;
+			++batch.incomplete;
 			continue;
 		}
 
-		// Patch the internal names inside the custom .mdl so it doesn't conflict with VPK
-		rule.is_patched = patch_mdl_internal_name(rule.original, rule.replacement);
+		rule.is_requested = true;
 
-		// Add the path once; adding duplicates needlessly grows the network string table.
-		if (precache_table->FindStringIndex(rule.replacement) == -1)
-			precache_table->AddString(false, rule.replacement);
+		precache_job job;
+		job.rule_index = i;
+		job.original = rule.original;
+		job.replacement = rule.replacement;
+		jobs.push_back(std::move(job));
+	}
 
-		// A failed load is sticky in MDLCache004. The fuller interface from the
-		// reference implementation lets us reset and retry that cached error.
-		auto handle = g_original_find_mdl
-			? g_original_find_mdl(g_mdl_cache, rule.replacement)
-			: g_mdl_cache->FindMDL(rule.replacement);
-		bool is_error_model = handle == MDLHANDLE_INVALID || g_mdl_cache->IsErrorModel(handle);
-		if (is_error_model && handle != MDLHANDLE_INVALID && g_mdl_vmt_size > 47)
-		{
-			g_mdl_cache->ResetErrorModelStatus(handle);
-			handle = g_original_find_mdl
-				? g_original_find_mdl(g_mdl_cache, rule.replacement)
-				: g_mdl_cache->FindMDL(rule.replacement);
-			is_error_model = handle == MDLHANDLE_INVALID || g_mdl_cache->IsErrorModel(handle);
-			if (!is_error_model)
-				++recovered_count;
-		}
+	if (batch.enabled == 0)
+	{
+		set_operation(operation_status::warning, "Nothing to apply: there are no enabled rules.");
+		return;
+	}
+
+	set_operation(operation_status::none, "Applying " + std::to_string(jobs.size()) + " rules...");
+	start_precache(std::move(jobs), batch);
+}
+
+auto model_changer::precache_models() -> void
+{
+	// The rules' precache state and the batches belong to the game thread
+	frame_scheduler::post(frame_scheduler::priority::high, "apply models", []
+	{
+		start_apply();
+		return true;
+	});
+}
 
-		if (!is_error_model && g_mdl_vmt_size > 46)
-			g_mdl_cache->PreloadModel(handle);
+// Game thread. Marks the model as used and brings it back if it was evicted;
+// MDLCache would also reload it on the next draw, but synchronously.
+static void touch_model(model_replacement& rule)
+{
+	const auto it = g_resident_models.find(rule.replacement);
+	if (it == g_resident_models.end())
+		return;
 
-		// Force the engine to load the model into memory first
-		g_model_info->FindOrLoadModel(rule.replacement);
+	it->second.last_used = std::chrono::steady_clock::now();
+	if (it->second.resident || rule.is_requested)
+		return;
 
-		// Get model index
-		rule.precached_index = g_model_info->GetModelIndex(rule.replacement);
-		if (!is_error_model && rule.precached_index > 0)
-			++applied_count;
-		else
+	rule.is_requested = true;
+
+	precache_batch batch;
+	batch.reason = precache_reason::reload;
+	batch.enabled = 1;
+
+	std::vector<precache_job> jobs(1);
+	jobs[0].rule_index = static_cast<std::size_t>(&rule - model_changer::g_replacements.data());
+	jobs[0].original = rule.original;
+	jobs[0].replacement = rule.replacement;
+	start_precache(std::move(jobs), batch);
+}
+
+auto model_changer::request_model(const char* model_name) -> void
+{
+	if (!g_enabled || !g_lazy_precache || !model_name || !g_map_loaded)
+		return;
+
+	for (std::size_t i = 0; i < g_replacements.size(); ++i)
+	{
+		auto& rule = g_replacements[i];
+		if (!rule.enabled || !is_rule_complete(rule) || !strstr(model_name, rule.original))
+			continue;
+
+		// First match wins, like in get_replacement_index
+		if (rule.precached_index > 0 || rule.is_requested)
+			return;
+
+		rule.is_requested = true;
+
+		precache_batch batch;
+		batch.reason = precache_reason::on_demand;
+		batch.enabled = 1;
+
+		std::vector<precache_job> jobs(1);
+		jobs[0].rule_index = i;
+		jobs[0].original = rule.original;
+		jobs[0].replacement = rule.replacement;
+		start_precache(std::move(jobs), batch);
+		return;
+	}
+}
+
+// Game thread. Folds newly started batches into the current run; also called
+// by each load task, whose batch may have started after this frame's merge.
+static void merge_precache_batches()
+{
+	auto& progress = g_precache_progress;
+
+	std::lock_guard<std::mutex> lock(g_precache_mutex);
+	for (const auto& batch : g_precache_batches)
+	{
+		if (progress.queued == 0 && progress.enabled == 0)
 		{
-			rule.precached_index = -1;
-			++failed_count;
+			progress = precache_progress();
+			progress.start = std::chrono::steady_clock::now();
 		}
+
+		progress.has_apply |= batch.reason == precache_reason::apply;
+		progress.has_map_start |= batch.reason == precache_reason::map_start;
+		progress.has_config_reload |= batch.reason == precache_reason::config_reload;
+		progress.enabled += batch.enabled;
+		progress.incomplete += batch.incomplete;
+		progress.queued += batch.queued;
 	}
+	g_precache_batches.clear();
+}
+
+// Engine stage of one model, a frame scheduler task on the game thread
+static void load_ready_job(const precache_job& job)
+{
+	auto* precache_table = g_string_table_container ? g_string_table_container->FindTable("modelprecache") : nullptr;
+
+	// Stale, the map changed since the job was queued
+	if (!precache_table || job.generation != g_precache_generation)
+		return;
+
+	merge_precache_batches();
 
-	if (enabled_count == 0)
+	auto& progress = g_precache_progress;
+	g_precache_worked = true;
+	++progress.completed;
+	progress.disk_ms += job.disk_ms;
+
+	// The rule list may have been edited since the job was queued
+	const auto rule = job.rule_index < model_changer::g_replacements.size()
+		&& job.replacement == model_changer::g_replacements[job.rule_index].replacement
+		? &model_changer::g_replacements[job.rule_index] : nullptr;
+
+	// Not a loose file is fine, the engine looks in its search paths
+	if (job.validation.is_rejected())
 	{
-		set_operation(operation_status::warning, "Nothing to apply: there are no enabled rules.");
+		if (progress.first_invalid.empty())
+			progress.first_invalid = job.replacement + ": " + mdl::describe(job.validation.status);
+		++progress.invalid;
 		return;
 	}
 
-	char summary[256];
-	snprintf(summary, sizeof(summary), "Applied %d of %d enabled rules", applied_count, enabled_count);
-	std::string message = summary;
-	if (incomplete_count > 0)
-		message += "; " + std::to_string(incomplete_count) + " incomplete";
-	if (failed_count > 0)
-		message += "; " + std::to_string(failed_count) + " failed to load";
-	if (recovered_count > 0)
-		message += "; recovered " + std::to_string(recovered_count) + " cached error model";
-	message += ".";
+	const auto engine_start = std::chrono::steady_clock::now();
+	auto recovered = false;
+	MDLHandle_t handle = MDLHANDLE_INVALID;
+	const auto index = load_precache_job(job, precache_table, recovered, handle);
+	const auto engine_ms = elapsed_ms(engine_start);
 
-	set_operation(
-		failed_count == 0 && incomplete_count == 0 ? operation_status::success
-			: (applied_count > 0 ? operation_status::warning : operation_status::error),
-		message);
+	progress.engine_ms += engine_ms;
+	if (recovered)
+		++progress.recovered;
+	if (index > 0)
+	{
+		++progress.applied;
+
+		auto& model = g_resident_models[job.replacement];
+		model.handle = handle;
+		model.bytes = job.validation.file_size;
+		if (!model.bytes && handle != MDLHANDLE_INVALID)
+			model.bytes = mdl::get_length(g_mdl_cache->GetStudioHdr(handle));
+		model.last_used = std::chrono::steady_clock::now();
+		model.resident = true;
+	}
+	else
+		++progress.failed;
+
+	if (job.disk_ms + engine_ms > progress.slowest_ms)
+	{
+		progress.slowest_ms = job.disk_ms + engine_ms;
+		progress.slowest = job.replacement;
+	}
+
+	if (job.reason == precache_reason::on_demand || job.reason == precache_reason::reload)
+	{
+		std::lock_guard<std::mutex> lock(g_precache_mutex);
+		if (job.reason == precache_reason::reload)
+			++g_precache_stats.reloads;
+		++g_precache_stats.on_demand_loads;
+		g_precache_stats.on_demand_ms += engine_ms;
+		g_precache_stats.worst_on_demand_ms = (std::max)(g_precache_stats.worst_on_demand_ms, engine_ms);
+	}
+
+	if (rule)
+	{
+		rule->is_patched = job.is_patched;
+		rule->precached_index = index;
+		model_changer::mark_rules_changed();
+	}
+
+	char status[320];
+	snprintf(status, sizeof(status), "Loading %d of %d: %s (disk %.1f ms, engine %.1f ms)",
+		progress.completed, progress.queued, model_basename(job.replacement.c_str()), job.disk_ms, engine_ms);
+	set_operation(model_changer::operation_status::none, status);
+}
+
+auto model_changer::run_precache_queue() -> void
+{
+	auto* precache_table = g_string_table_container ? g_string_table_container->FindTable("modelprecache") : nullptr;
+	if (!precache_table)
+	{
+		if (g_map_loaded)
+			on_map_unloaded();
+		return;
+	}
+
+	// A changelevel doesn't always leave a frame without the table, a new
+	// table or level name is a new map too
+	const auto level_name = g_engine->GetLevelName();
+	if (g_map_loaded && (precache_table != g_map_precache_table || g_map_level_name != (level_name ? level_name : "")))
+		on_map_unloaded();
+
+	if (!g_map_loaded)
+	{
+		g_map_precache_table = precache_table;
+		g_map_level_name = level_name ? level_name : "";
+		on_map_loaded();
+	}
+
+	enforce_model_budget();
+
+	if (!g_precache_active)
+		return;
+
+	auto& progress = g_precache_progress;
+
+	// Loads ran in the scheduler after last frame's call
+	if (g_precache_worked)
+	{
+		g_precache_worked = false;
+		++progress.frames;
+		publish_residency();
+	}
+
+	merge_precache_batches();
+
+	if (progress.completed < progress.queued)
+		return;
+
+	{
+		// A batch started by another thread since the merge keeps the run going
+		std::lock_guard<std::mutex> lock(g_precache_mutex);
+		if (!g_precache_batches.empty())
+			return;
+		g_precache_active = false;
+	}
+
+	finish_precache();
+	progress = precache_progress();
 }
 
 int model_changer::get_replacement_index(const char* original_model_name)
+{
+	return use_rule(find_loaded_rule(original_model_name));
+}
+
+int model_changer::find_loaded_rule(const char* original_model_name)
 {
 	if (!g_enabled || !original_model_name) return -1;
-	for (const auto& rule : g_replacements)
+	for (std::size_t i = 0; i < g_replacements.size(); ++i)
 	{
+		const auto& rule = g_replacements[i];
 		if (rule.enabled && rule.original[0] != '\0' && rule.precached_index > 0
 			&& strstr(original_model_name, rule.original))
-			return rule.precached_index;
+			return static_cast<int>(i);
 	}
 	return -1;
 }
 
+int model_changer::use_rule(int rule_index)
+{
+	if (!g_enabled || rule_index < 0 || rule_index >= static_cast<int>(g_replacements.size()))
+		return -1;
+
+	auto& rule = g_replacements[rule_index];
+	if (!rule.enabled || rule.precached_index <= 0)
+		return -1;
+
+	touch_model(rule);
+	return rule.precached_index;
+}
+
+auto model_changer::get_rules_generation() -> unsigned
+{
+	return g_rules_generation;
+}
+
+auto model_changer::mark_rules_changed() -> void
+{
+	++g_rules_generation;
+}
+
 // ========================================================
 // JSON Config
 // ========================================================
@@ -653,7 +1519,8 @@ static void model_to_json(json& j, const model_replacement& o)
 	j = json{
 		{"enabled", o.enabled},
 		{"original", std::string(o.original)},
-		{"replacement", std::string(o.replacement)}
+		{"replacement", std::string(o.replacement)},
+		{"prefetch", o.prefetch}
 	};
 }
 
@@ -664,8 +1531,10 @@ static void model_from_json(const json& j, model_replacement& o)
 		copy_config_string(o.original, j["original"].get<std::string>());
 	if (j.contains("replacement"))
 		copy_config_string(o.replacement, j["replacement"].get<std::string>());
+	if (j.contains("prefetch")) o.prefetch = j["prefetch"].get<bool>();
 	o.precached_index = -1;
 	o.is_patched = false;
+	o.is_requested = false;
 }
 
 auto model_changer::save_config() -> void
@@ -675,6 +1544,8 @@ auto model_changer::save_config() -> void
 		json j;
 		j["enabled"] = g_enabled;
 		j["custom_sounds"] = g_enable_custom_sounds;
+		j["lazy_precache"] = g_lazy_precache;
+		j["memory_budget_mb"] = g_model_budget_mb;
 		json rules_arr = json::array();
 		for (const auto& rule : g_replacements)
 		{
@@ -716,34 +1587,16 @@ auto model_changer::load_config() -> void
 			return;
 		}
 
-		auto j = json::parse(ifile);
-		if (!j.is_object())
-			throw std::runtime_error("the config root must be an object");
+		auto contents = parse_config(std::string(std::istreambuf_iterator<char>(ifile), std::istreambuf_iterator<char>()));
 
-		auto loaded_enabled = g_enabled;
-		auto loaded_custom_sounds = g_enable_custom_sounds;
-		auto loaded_rules = g_replacements;
-
-		if (j.contains("enabled")) loaded_enabled = j["enabled"].get<bool>();
-		if (j.contains("custom_sounds")) loaded_custom_sounds = j["custom_sounds"].get<bool>();
-		if (j.contains("rules"))
-		{
-			if (!j["rules"].is_array())
-				throw std::runtime_error("rules must be an array");
-			loaded_rules.clear();
-			for (const auto& rj : j["rules"])
-			{
-				if (!rj.is_object())
-					throw std::runtime_error("each rule must be an object");
-				model_replacement rule;
-				model_from_json(rj, rule);
-				loaded_rules.push_back(rule);
-			}
-		}
-
-		g_enabled = loaded_enabled;
-		g_enable_custom_sounds = loaded_custom_sounds;
-		g_replacements = std::move(loaded_rules);
+		std::lock_guard<std::recursive_mutex> lock(g_rules_mutex);
+		g_enabled = contents.enabled.value_or(g_enabled);
+		g_enable_custom_sounds = contents.custom_sounds.value_or(g_enable_custom_sounds);
+		g_lazy_precache = contents.lazy_precache.value_or(g_lazy_precache);
+		g_model_budget_mb = contents.budget_mb.value_or(g_model_budget_mb);
+		if (contents.rules)
+			g_replacements = std::move(*contents.rules);
+		mark_rules_changed();
 		set_operation(operation_status::success,
 			"Loaded " + std::to_string(g_replacements.size()) + " rules from nSkinz_models.json; apply when in a map.");
 	}
@@ -754,63 +1607,148 @@ auto model_changer::load_config() -> void
 	}
 }
 
-// ========================================================
-// Directory scanner
-// ========================================================
+auto model_changer::parse_config(const std::string& text) -> config_contents
+{
+	auto j = json::parse(text);
+	if (!j.is_object())
+		throw std::runtime_error("the config root must be an object");
+
+	config_contents contents;
+	if (j.contains("enabled")) contents.enabled = j["enabled"].get<bool>();
+	if (j.contains("custom_sounds")) contents.custom_sounds = j["custom_sounds"].get<bool>();
+	if (j.contains("lazy_precache")) contents.lazy_precache = j["lazy_precache"].get<bool>();
+	if (j.contains("memory_budget_mb")) contents.budget_mb = (std::max)(0, j["memory_budget_mb"].get<int>());
+	if (j.contains("rules"))
+	{
+		if (!j["rules"].is_array())
+			throw std::runtime_error("rules must be an array");
+		contents.rules.emplace();
+		for (const auto& rj : j["rules"])
+		{
+			if (!rj.is_object())
+				throw std::runtime_error("each rule must be an object");
+			model_replacement rule;
+			model_from_json(rj, rule);
+			contents.rules->push_back(rule);
+		}
+	}
+
+	return contents;
+}
 
-static void scan_directory(const std::string& base_path, const std::string& relative_path, std::vector<std::string>& results)
+static bool is_same_model(const model_replacement& left, const model_replacement& right)
 {
-	WIN32_FIND_DATAA find_data;
-	HANDLE h_find = FindFirstFileA((base_path + relative_path + "*").c_str(), &find_data);
-	if (h_find == INVALID_HANDLE_VALUE) return;
+	return strcmp(left.original, right.original) == 0 && strcmp(left.replacement, right.replacement) == 0;
+}
 
-	do
+auto model_changer::apply_config_changes(config_contents contents) -> bool
+{
+	auto changed = false;
+	const auto take = [&changed](auto& live, const auto& loaded)
 	{
-		const std::string name = find_data.cFileName;
-		if (name == "." || name == "..") continue;
+		if (loaded && *loaded != live)
+		{
+			live = *loaded;
+			changed = true;
+		}
+	};
+
+	take(g_enabled, contents.enabled);
+	take(g_enable_custom_sounds, contents.custom_sounds);
+	take(g_lazy_precache, contents.lazy_precache);
+	take(g_model_budget_mb, contents.budget_mb);
+
+	if (!contents.rules)
+		return changed;
 
-		if ((find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-			&& !(find_data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT))
-			scan_directory(base_path, relative_path + name + "\\", results);
-		else if (name.length() > 4)
+	auto& rules = *contents.rules;
+
+	const auto same_rules = rules.size() == g_replacements.size()
+		&& std::equal(rules.begin(), rules.end(), g_replacements.begin(), [](const auto& left, const auto& right)
 		{
-			std::string ext = name.substr(name.length() - 4);
-			std::transform(ext.begin(), ext.end(), ext.begin(),
-				[](unsigned char c) { return (char)std::tolower(c); });
-			if (ext == ".mdl")
-			{
-				std::string rel = relative_path + name;
-				std::replace(rel.begin(), rel.end(), '\\', '/');
-				results.push_back("models/" + rel);
-			}
+			return left.enabled == right.enabled && left.prefetch == right.prefetch && is_same_model(left, right);
+		});
+	if (same_rules)
+		return changed;
+
+	// Rules for a model that is already loaded keep it, the rest need loading
+	std::vector<std::size_t> fresh;
+	for (std::size_t i = 0; i < rules.size(); ++i)
+	{
+		auto& rule = rules[i];
+		const auto live = std::find_if(g_replacements.begin(), g_replacements.end(), [&rule](const model_replacement& other)
+		{
+			return other.precached_index > 0 && is_same_model(rule, other);
+		});
+
+		if (live != g_replacements.end())
+		{
+			rule.precached_index = live->precached_index;
+			rule.is_patched = live->is_patched;
+			rule.is_requested = live->is_requested;
+		}
+		else if (rule.enabled && is_rule_complete(rule))
+			fresh.push_back(i);
+	}
+
+	// The menu can't be holding references, the caller has the lock
+	g_replacements = std::move(rules);
+	mark_rules_changed();
+
+	// Lazy mode loads them when their weapon shows up, like any other rule
+	if (g_enabled && !g_lazy_precache && g_map_loaded && !fresh.empty())
+	{
+		precache_batch batch;
+		batch.reason = precache_reason::config_reload;
+		batch.enabled = static_cast<int>(fresh.size());
+
+		std::vector<precache_job> jobs;
+		for (const auto i : fresh)
+		{
+			auto& rule = g_replacements[i];
+			rule.is_requested = true;
+
+			precache_job job;
+			job.rule_index = i;
+			job.original = rule.original;
+			job.replacement = rule.replacement;
+			jobs.push_back(std::move(job));
 		}
-	} while (FindNextFileA(h_find, &find_data));
-	FindClose(h_find);
+
+		start_precache(std::move(jobs), batch);
+	}
+	else
+		set_operation(operation_status::success,
+			"Reloaded " + std::to_string(g_replacements.size()) + " rules from nSkinz_models.json.");
+
+	return true;
+}
+
+// ========================================================
+// Directory scanner
+// ========================================================
+
+auto model_changer::is_scanning() -> bool
+{
+	return g_model_index.is_running();
 }
 
 auto model_changer::scan_installed_models() -> void
 {
-	g_installed_models.clear();
-	g_models_root.clear();
-	char exe_path[MAX_PATH];
-	if (GetModuleFileNameA(nullptr, exe_path, MAX_PATH) == 0)
+	const auto game_dir = get_game_dir();
+	if (game_dir.empty())
 	{
 		g_models_scanned = true;
 		set_operation(operation_status::error, "Model scan failed: the game directory could not be resolved.");
 		return;
 	}
-	std::string game_dir = exe_path;
-	auto last_slash = game_dir.find_last_of("\\/");
-	if (last_slash != std::string::npos) game_dir = game_dir.substr(0, last_slash + 1);
 
+	std::error_code error;
 	std::string models_dir = game_dir + "csgo\\models\\";
-	WIN32_FIND_DATAA test;
-	HANDLE h_test = FindFirstFileA((models_dir + "*").c_str(), &test);
-	if (h_test == INVALID_HANDLE_VALUE)
+	if (!std::filesystem::is_directory(models_dir, error))
 	{
 		models_dir = game_dir + "models\\";
-		h_test = FindFirstFileA((models_dir + "*").c_str(), &test);
-		if (h_test == INVALID_HANDLE_VALUE)
+		if (!std::filesystem::is_directory(models_dir, error))
 		{
 			g_models_scanned = true;
 			set_operation(operation_status::error,
@@ -818,19 +1756,28 @@ auto model_changer::scan_installed_models() -> void
 			return;
 		}
 	}
-	FindClose(h_test);
 
 	g_models_root = models_dir;
-	scan_directory(models_dir, "", g_installed_models);
-	std::sort(g_installed_models.begin(), g_installed_models.end());
-	g_installed_models.erase(
-		std::unique(g_installed_models.begin(), g_installed_models.end()),
-		g_installed_models.end());
-	g_models_scanned = true;
-	set_operation(g_installed_models.empty() ? operation_status::warning : operation_status::success,
-		g_installed_models.empty()
-			? "Model scan completed, but no loose .mdl files were found."
-			: "Found " + std::to_string(g_installed_models.size()) + " installed model files.");
+	set_operation(operation_status::none, "Scanning installed models...");
+
+	// Installed paths start with "models/", so validate relative to the parent of the root
+	auto content_dir = models_dir.substr(0, models_dir.length() - strlen("models\\"));
+	g_model_index.scan_async(models_dir, [content_dir](const file_indexer::scan_stats& stats)
+	{
+		const auto models = g_model_index.get_files();
+		std::atomic_store(&g_installed_models, models);
+		g_models_scanned = true;
+
+		model_validator::validate_library_async(content_dir, *models);
+
+		char timing[96];
+		snprintf(timing, sizeof(timing), " (%d of %d folders rescanned, %.0f ms)",
+			stats.rescanned, stats.directories, stats.milliseconds);
+		set_operation(models->empty() ? operation_status::warning : operation_status::success,
+			models->empty()
+				? std::string("Model scan completed, but no loose .mdl files were found.")
+				: "Found " + std::to_string(models->size()) + " installed model files" + timing + ".");
+	});
 }
 
 // ========================================================
@@ -841,6 +1788,10 @@ auto model_changer::initialize() -> void
 {
 	load_config();
 
+	const auto game_dir = get_game_dir();
+	if (!game_dir.empty())
+		g_sound_index.scan_async(game_dir + "csgo\\sound\\custom\\");
+
 	// ---- Get string table container for precaching ----
 	g_string_table_container = reinterpret_cast<CNetworkStringTableContainer*>(
 		platform::get_interface("engine.dll", "VEngineClientStringTable001"));
@@ -1014,6 +1965,14 @@ auto model_changer::initialize() -> void
 
 auto model_changer::uninitialize() -> void
 {
+	++g_precache_generation;
+	g_precache_active = false;
+	join_precache_workers(false);
+
+	g_model_index.shutdown();
+	g_sound_index.shutdown();
+	model_validator::shutdown();
+
 	if (g_mdl_instance && g_mdl_original_vmt) *g_mdl_instance = (DWORD)g_mdl_original_vmt;
 	if (g_mdl_custom_vmt) { free(g_mdl_custom_vmt); g_mdl_custom_vmt = nullptr; }
 	
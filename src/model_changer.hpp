@@ -1,6 +1,11 @@
 #pragma once
 #include "SDK/IMDLCache.hpp"
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <vector>
 #include <string>
 #include <Windows.h>
@@ -13,6 +18,8 @@ struct model_replacement
 	char replacement[256] = "";  // Full replacement path
 	int precached_index = -1;    // Cached model index after precaching
 	bool is_patched = false;     // Whether internal name is patched in the .mdl header
+	bool prefetch = false;       // Load at map start even in lazy mode
+	bool is_requested = false;   // Queued for precaching on the current map
 };
 
 namespace model_changer
@@ -26,20 +33,46 @@ namespace model_changer
 	};
 
 	extern std::vector<model_replacement> g_replacements;
+
+	// Held by the menu while it shows or edits the rules, and by anything that
+	// replaces g_replacements as a whole. The game thread only try_locks it.
+	extern std::recursive_mutex g_rules_mutex;
 	extern bool g_enabled;
 	extern bool g_enable_custom_sounds;
 
-	// Retrieves the precached index of a custom model if a rule matches
+	// Load a replacement only when its weapon first shows up, instead of every
+	// enabled rule when the map starts
+	extern bool g_lazy_precache;
+
+	// Cap for resident custom models in MB, 0 for no limit. Models over the
+	// budget are released least recently used first and reload on next use.
+	extern int g_model_budget_mb;
+
+	// Retrieves the precached index of a custom model if a rule matches, and
+	// marks that model as used. Game thread only.
 	int get_replacement_index(const char* original_model_name);
 
-	// Installed model files scanned from game directory
-	extern std::vector<std::string> g_installed_models;
-	extern bool g_models_scanned;
+	// The two halves of get_replacement_index, for callers that cache the match:
+	// the first loaded rule matching the model or -1, and the precached index of
+	// a rule, which also marks its model as used. Game thread only.
+	int find_loaded_rule(const char* original_model_name);
+	int use_rule(int rule_index);
+
+	// Bumped whenever the result of find_loaded_rule may have changed: rules
+	// edited, added, removed or reordered, or a rule's model loaded or dropped.
+	// The menu calls mark_rules_changed after editing g_replacements.
+	auto get_rules_generation() -> unsigned;
+	auto mark_rules_changed() -> void;
+
+	// Installed model files scanned from game directory. Replaced as a whole when
+	// a background scan finishes, read it with std::atomic_load.
+	extern std::shared_ptr<const std::vector<std::string>> g_installed_models;
+	extern std::atomic<bool> g_models_scanned;
 	extern std::string g_models_root;
 
 	// Feedback from the last scan/apply/config action
-	extern operation_status g_last_operation_status;
-	extern std::string g_last_operation_message;
+	extern std::atomic<operation_status> g_last_operation_status;
+	auto get_last_operation_message() -> std::string;
 
 	// Hook status
 	extern bool g_hook_active;
@@ -50,10 +83,70 @@ namespace model_changer
 	auto initialize() -> void;
 	auto uninitialize() -> void;
 
+	// Starts an incremental rescan on a worker thread
 	auto scan_installed_models() -> void;
+	auto is_scanning() -> bool;
 	auto save_config() -> void;
 	auto load_config() -> void;
 
-	// Precache all replacement models into the string table
+	// nSkinz_models.json as read from disk. Keys the file doesn't have stay
+	// unset and keep the live value.
+	struct config_contents
+	{
+		std::optional<bool> enabled;
+		std::optional<bool> custom_sounds;
+		std::optional<bool> lazy_precache;
+		std::optional<int> budget_mb;
+		std::optional<std::vector<model_replacement>> rules;
+	};
+
+	// Throws if the file is malformed. Any thread.
+	auto parse_config(const std::string& text) -> config_contents;
+
+	// For a reload of an edited file, game thread only, with g_rules_mutex
+	// held. Rules that are still there keep their loaded model, new or edited
+	// ones are loaded like Apply would. False if nothing differs from the live
+	// settings.
+	auto apply_config_changes(config_contents contents) -> bool;
+
+	// Starts precaching all enabled replacement models on the game thread's
+	// next frame. Disk work runs on workers; the engine calls are drained by
+	// run_precache_queue. Any thread.
 	auto precache_models() -> void;
+	auto is_precaching() -> bool;
+
+	// Lazy mode: queues the rule matching this model if it isn't loaded yet.
+	// Game thread only.
+	auto request_model(const char* model_name) -> void;
+
+	// Numbers for the current map
+	struct precache_stats
+	{
+		bool lazy = false;
+		int resident_models = 0;
+		std::uint64_t resident_bytes = 0; // .mdl sizes, vertex data not included
+		double map_load_ms = 0.0;         // Map start until the map's batch finished
+		int on_demand_loads = 0;
+		double on_demand_ms = 0.0;        // Game thread time spent in on-demand loads
+		double worst_on_demand_ms = 0.0;
+		int evictions = 0;
+		int reloads = 0;
+	};
+
+	struct resident_model_info
+	{
+		std::string path;
+		std::uint64_t bytes = 0;
+		double idle_seconds = 0.0;
+		bool resident = false;
+	};
+
+	auto get_precache_stats() -> precache_stats;
+
+	// Models loaded on this map, most recently used first
+	auto get_resident_models() -> std::vector<resident_model_info>;
+
+	// Game thread only, called every frame from FrameStageNotify. Also notices
+	// map changes, which invalidate every precached index.
+	auto run_precache_queue() -> void;
 }
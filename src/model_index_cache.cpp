@@ -0,0 +1,62 @@
+#include "model_index_cache.hpp"
+#include "item_definitions.hpp"
+#include "model_changer.hpp"
+#include "nSkinz.hpp"
+
+#include <array>
+
+namespace
+{
+	struct cached_model
+	{
+		int model_index = -1;
+		int rule_index = -1;
+		bool rule_resolved = false;
+		unsigned rules_generation = 0;
+	};
+
+	// Parallel to the get_weapon_info table, filled in as the items show up
+	std::array<cached_model, game_data::weapon_info_count> s_models;
+
+	auto get_entry(const int definition_index) -> cached_model*
+	{
+		const auto slot = game_data::get_weapon_info_slot(definition_index);
+		return slot < 0 ? nullptr : &s_models[slot];
+	}
+}
+
+auto model_index_cache::get_model_index(const int definition_index) -> int
+{
+	const auto entry = get_entry(definition_index);
+	if(!entry)
+		return -1;
+
+	// Models that weren't precached yet are looked up again, the server may still add them
+	if(entry->model_index < 0)
+		entry->model_index = g_model_info->GetModelIndex(game_data::get_weapon_info(definition_index)->model);
+
+	return entry->model_index;
+}
+
+auto model_index_cache::get_replacement_index(const int definition_index) -> int
+{
+	const auto entry = get_entry(definition_index);
+	if(!entry)
+		return -1;
+
+	// Rules only change from the menu or when a custom model loads
+	const auto generation = model_changer::get_rules_generation();
+	if(!entry->rule_resolved || entry->rules_generation != generation)
+	{
+		entry->rule_index = model_changer::find_loaded_rule(game_data::get_weapon_info(definition_index)->model);
+		entry->rule_resolved = true;
+		entry->rules_generation = generation;
+	}
+
+	return model_changer::use_rule(entry->rule_index);
+}
+
+auto model_index_cache::invalidate() -> void
+{
+	s_models.fill(cached_model());
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+// Model indices for the get_weapon_info entries, looked up once per map instead
+// of by name on every PostDataUpdate. Game thread only.
+namespace model_index_cache
+{
+	// Index of the stock model, -1 if it has no entry or isn't precached
+	auto get_model_index(int definition_index) -> int;
+
+	// Precached index of the custom model replacing the stock one, -1 if no
+	// loaded rule matches. Marks the custom model as used.
+	auto get_replacement_index(int definition_index) -> int;
+
+	// Model indices don't survive a map change
+	auto invalidate() -> void;
+}
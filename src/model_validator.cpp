@@ -0,0 +1,266 @@
+#include "model_validator.hpp"
+#include "Utilities/fnv_hash.hpp"
+#include "Utilities/jobs.hpp"
+#include "Utilities/parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <mutex>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	struct cache_entry
+	{
+		std::uint64_t size = 0;
+		fs::file_time_type mtime;
+		fnv::hash content_hash = 0;
+		model_validator::result result;
+	};
+
+	std::mutex s_cache_mutex;
+	std::unordered_map<std::string, cache_entry> s_cache;
+
+	std::mutex s_published_mutex;
+	std::shared_ptr<const model_validator::result_map> s_published = std::make_shared<const model_validator::result_map>();
+	model_validator::library_stats s_last_stats;
+
+	std::mutex s_worker_mutex;
+	std::future<void> s_worker;
+	bool s_worker_running = false;
+	bool s_has_pending = false;
+	std::string s_pending_base_dir;
+	std::vector<std::string> s_pending_paths;
+	std::atomic<bool> s_shutdown{ false };
+
+	auto read_file(const fs::path& path, std::vector<std::uint8_t>& contents) -> bool
+	{
+		auto file = std::ifstream(path, std::ios::binary | std::ios::ate);
+		if(!file.good())
+			return false;
+
+		const auto size = std::streamoff(file.tellg());
+		if(size <= 0)
+			return false;
+
+		contents.resize(std::size_t(size));
+		file.seekg(0);
+		file.read(reinterpret_cast<char*>(contents.data()), size);
+		return file.good();
+	}
+
+	auto check_file(const std::string& base_dir, const std::string& relative_path,
+		const std::string& key, bool& reused) -> model_validator::result
+	{
+		reused = false;
+
+		model_validator::result result;
+
+		const auto full_path = fs::path(base_dir) / fs::path(relative_path);
+
+		std::error_code error;
+		const auto size = std::uint64_t(fs::file_size(full_path, error));
+		if(error)
+			return result;
+		const auto mtime = fs::last_write_time(full_path, error);
+		if(error)
+			return result;
+
+		auto has_previous = false;
+		auto previous_hash = fnv::hash(0);
+		{
+			std::lock_guard<std::mutex> lock(s_cache_mutex);
+			const auto it = s_cache.find(key);
+			if(it != s_cache.end())
+			{
+				if(it->second.size == size && it->second.mtime == mtime)
+				{
+					reused = true;
+					return it->second.result;
+				}
+
+				has_previous = it->second.size == size;
+				previous_hash = it->second.content_hash;
+			}
+		}
+
+		std::vector<std::uint8_t> contents;
+		if(!read_file(full_path, contents))
+			return result;
+
+		const auto content_hash = fnv::hash_bytes(contents.data(), contents.size());
+
+		std::lock_guard<std::mutex> lock(s_cache_mutex);
+		auto& entry = s_cache[key];
+
+		// Touched but not modified, e.g. copied over with the same file
+		if(has_previous && previous_hash == content_hash)
+		{
+			reused = true;
+			entry.mtime = mtime;
+			return entry.result;
+		}
+
+		result.file_size = size;
+		result.status = mdl::parse_header(contents.data(), contents.size(), result.header);
+
+		entry.size = size;
+		entry.mtime = mtime;
+		entry.content_hash = content_hash;
+		entry.result = result;
+
+		return result;
+	}
+
+	auto validate_library(const std::string& base_dir, const std::vector<std::string>& relative_paths) -> void
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		std::vector<std::string> keys(relative_paths.size());
+		std::vector<model_validator::result> results(relative_paths.size());
+		std::atomic<int> reused_count{ 0 };
+
+		parallel::for_each_index(relative_paths.size(), [&](const std::size_t i)
+		{
+			if(s_shutdown)
+				return;
+
+			keys[i] = model_validator::normalize_path(relative_paths[i]);
+
+			auto reused = false;
+			results[i] = check_file(base_dir, relative_paths[i], keys[i], reused);
+			if(reused)
+				++reused_count;
+		});
+
+		if(s_shutdown)
+			return;
+
+		auto published = std::make_shared<model_validator::result_map>();
+		published->reserve(results.size());
+
+		model_validator::library_stats stats;
+		stats.total = int(results.size());
+		stats.reused = reused_count;
+
+		for(auto i = std::size_t(0); i < results.size(); ++i)
+		{
+			if(!results[i].is_valid())
+				++stats.invalid;
+			published->emplace(std::move(keys[i]), results[i]);
+		}
+
+		stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		std::lock_guard<std::mutex> lock(s_published_mutex);
+		s_published = std::move(published);
+		s_last_stats = stats;
+	}
+
+	auto worker_loop() -> void
+	{
+		for(;;)
+		{
+			std::string base_dir;
+			std::vector<std::string> paths;
+			{
+				std::lock_guard<std::mutex> lock(s_worker_mutex);
+				if(!s_has_pending || s_shutdown)
+				{
+					s_worker_running = false;
+					return;
+				}
+
+				base_dir = std::move(s_pending_base_dir);
+				paths = std::move(s_pending_paths);
+				s_has_pending = false;
+			}
+
+			validate_library(base_dir, paths);
+		}
+	}
+}
+
+auto model_validator::normalize_path(const std::string& path) -> std::string
+{
+	auto normalized = path;
+	std::transform(normalized.begin(), normalized.end(), normalized.begin(), [](const unsigned char c)
+	{
+		return c == '\\' ? '/' : char(std::tolower(c));
+	});
+	return normalized;
+}
+
+auto model_validator::validate_file(const std::string& base_dir, const std::string& relative_path) -> result
+{
+	auto reused = false;
+	return check_file(base_dir, relative_path, normalize_path(relative_path), reused);
+}
+
+auto model_validator::validate_library_async(std::string base_dir, std::vector<std::string> relative_paths) -> void
+{
+	std::lock_guard<std::mutex> lock(s_worker_mutex);
+
+	if(s_shutdown)
+		return;
+
+	s_pending_base_dir = std::move(base_dir);
+	s_pending_paths = std::move(relative_paths);
+	s_has_pending = true;
+
+	if(s_worker_running)
+		return;
+
+	if(s_worker.valid())
+		s_worker.wait();
+
+	s_worker_running = true;
+	s_worker = jobs::submit(worker_loop);
+}
+
+auto model_validator::is_running() -> bool
+{
+	std::lock_guard<std::mutex> lock(s_worker_mutex);
+	return s_worker_running;
+}
+
+auto model_validator::get_results() -> std::shared_ptr<const result_map>
+{
+	std::lock_guard<std::mutex> lock(s_published_mutex);
+	return s_published;
+}
+
+auto model_validator::get_last_stats() -> library_stats
+{
+	std::lock_guard<std::mutex> lock(s_published_mutex);
+	return s_last_stats;
+}
+
+auto model_validator::find(const result_map& results, const char* relative_path) -> const result*
+{
+	if(!relative_path || relative_path[0] == '\0')
+		return nullptr;
+
+	const auto it = results.find(normalize_path(relative_path));
+	return it == results.end() ? nullptr : &it->second;
+}
+
+auto model_validator::shutdown() -> void
+{
+	s_shutdown = true;
+
+	std::future<void> worker;
+	{
+		std::lock_guard<std::mutex> lock(s_worker_mutex);
+		worker = std::move(s_worker);
+	}
+
+	if(worker.valid())
+		worker.wait();
+}
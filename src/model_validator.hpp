@@ -0,0 +1,59 @@
+#pragma once
+#include "mdl_parser.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Checks the headers of installed .mdl files before the engine gets to see them.
+// Results are cached per file by size, mtime and content hash, so a rescan of an
+// unchanged library only costs a stat per file.
+namespace model_validator
+{
+	struct result
+	{
+		mdl::parse_status status = mdl::parse_status::io_error;
+		mdl::header_info header;
+		std::uint64_t file_size = 0;
+
+		auto is_valid() const -> bool { return status == mdl::parse_status::ok; }
+
+		// Read and found broken. A file that couldn't be read isn't: the model
+		// may still come from a VPK or another search path.
+		auto is_rejected() const -> bool { return status != mdl::parse_status::ok && status != mdl::parse_status::io_error; }
+	};
+
+	// Keys are normalized relative paths, see normalize_path
+	using result_map = std::unordered_map<std::string, result>;
+
+	struct library_stats
+	{
+		int total = 0;
+		int invalid = 0;
+		int reused = 0;
+		double milliseconds = 0.0;
+	};
+
+	// Lowercase, forward slashes; "Models\\Foo.MDL" and "models/foo.mdl" are the same file
+	auto normalize_path(const std::string& path) -> std::string;
+
+	// Validates one file synchronously, using and filling the cache
+	auto validate_file(const std::string& base_dir, const std::string& relative_path) -> result;
+
+	// Validates the whole list on all cores on a background thread. Calling this
+	// while a run is in progress queues one more run with the newest list.
+	auto validate_library_async(std::string base_dir, std::vector<std::string> relative_paths) -> void;
+
+	auto is_running() -> bool;
+
+	// Latest published results, safe to call from any thread. Never null.
+	auto get_results() -> std::shared_ptr<const result_map>;
+	auto get_last_stats() -> library_stats;
+
+	// Returns nullptr if the path wasn't validated yet
+	auto find(const result_map& results, const char* relative_path) -> const result*;
+
+	auto shutdown() -> void;
+}
@@ -30,6 +30,14 @@
 #include "config.hpp"
 #include "model_changer.hpp"
 #include "hitmarker.hpp"
+#include "sequence_remap.hpp"
+#include "local_player.hpp"
+#include "sticker_changer.hpp"
+#include "trace.hpp"
+#include "frame_scheduler.hpp"
+#include "hot_reload.hpp"
+#include "Utilities/jobs.hpp"
+#include "Utilities/task_graph.hpp"
 
 sdk::IBaseClientDLL*		g_client;
 sdk::IClientEntityList*		g_entity_list;
@@ -44,34 +52,63 @@ sdk::CBaseClientState**		g_client_state;
 sdk::C_CS_PlayerResource**	g_player_resource;
 IMDLCache*					g_mdl_cache;
 
-//vmt_smart_hook*				g_client_hook;
+vmt_smart_hook*				g_client_hook;
 //vmt_smart_hook*				g_game_event_manager_hook;
 
 recv_prop_hook*				g_sequence_hook;
 
+std::atomic<unsigned>		g_level_generation{ 0 };
+
+startup_timings				g_startup_timings;
+
+// Set to false to run the startup steps one after another, in the old order
+static constexpr auto k_parallel_startup = true;
+
+// The level the notice HUD was hooked on, game thread only
+static unsigned				g_notice_hooked_generation = ~0u;
+
+// Per instance hooks, restored on unload
+static vmt_multi_hook		g_notice_hook;
+static vmt_multi_hook		g_player_hook;
+
 auto ensure_dynamic_hooks() -> void
 {
-	// find by xref to "CHudSaveStatus"
-	const auto hss = get_vfunc<char*>(g_client, 87);
-	const auto hud = *(void**)(hss + 7);
-	const auto off = *(int32_t*)(hss + 12);
-	const auto fn = (void*(__thiscall *)(void*, const char*))(hss + 16 + off);
-	const auto notice_hud = fn(hud, "SFHudDeathNoticeAndBotStatus");
-	if(notice_hud)
+	const auto local = local_player::get().player;
+	const auto networkable = static_cast<sdk::IClientNetworkable*>(local);
+
+	// A full update can recreate the player at the same address with the
+	// engine's vtable, so the vtable is checked rather than the pointer
+	const auto player_hooked = !local || g_player_hook.is_hooked(networkable);
+
+	const auto level_generation = g_level_generation.load();
+	const auto notice_hooked = level_generation == g_notice_hooked_generation;
+	if(player_hooked && notice_hooked)
+		return;
+
+	++hooks::g_dynamic_hook_installs;
+
+	// The HUD element outlives maps, but there's no telling when it gets recreated.
+	// Until it exists we try again every frame.
+	if(!notice_hooked)
 	{
-		static vmt_multi_hook notice_hook;
-		if(notice_hook.initialize_and_hook_instance(notice_hud))
-			notice_hook.apply_hook<hooks::SFHudDeathNoticeAndBotStatus_FireGameEvent>(1);
+		// find by xref to "CHudSaveStatus"
+		const auto hss = get_vfunc<char*>(g_client, 87);
+		const auto hud = *(void**)(hss + 7);
+		const auto off = *(int32_t*)(hss + 12);
+		const auto fn = (void*(__thiscall *)(void*, const char*))(hss + 16 + off);
+		const auto notice_hud = fn(hud, "SFHudDeathNoticeAndBotStatus");
+		if(notice_hud)
+		{
+			if(g_notice_hook.initialize_and_hook_instance(notice_hud))
+				g_notice_hook.apply_hook<hooks::SFHudDeathNoticeAndBotStatus_FireGameEvent>(1);
+			g_notice_hooked_generation = level_generation;
+		}
 	}
 
-	const auto local_index = g_engine->GetLocalPlayer();
-	const auto local = static_cast<sdk::C_BasePlayer*>(g_entity_list->GetClientEntity(local_index));
-	if(local)
+	if(!player_hooked)
 	{
-		static vmt_multi_hook player_hook;
-		const auto networkable = static_cast<sdk::IClientNetworkable*>(local);
-		if(player_hook.initialize_and_hook_instance(networkable))
-			player_hook.apply_hook<hooks::CCSPlayer_PostDataUpdate>(7);
+		if(g_player_hook.initialize_and_hook_instance(networkable))
+			g_player_hook.apply_hook<hooks::CCSPlayer_PostDataUpdate>(7);
 	}
 }
 
@@ -89,46 +126,88 @@ auto get_client_name() -> const char*
 	return name;
 }
 
+// Adds a startup step that records a trace span of the same name
+template <typename Fn>
+static auto add_step(task_graph& graph, const char* name, const task_graph::affinity where, Fn fn,
+	const std::initializer_list<task_graph::task_id> dependencies = {}) -> task_graph::task_id
+{
+	return graph.add(name, where, [name, fn]
+	{
+		trace::scope scope(name);
+		fn();
+	}, dependencies);
+}
+
 auto initialize(void* instance) -> void
 {
-	g_client = get_interface<sdk::IBaseClientDLL>(get_client_name(), CLIENT_DLL_INTERFACE_VERSION);
-	g_entity_list = get_interface<sdk::IClientEntityList>(get_client_name(), VCLIENTENTITYLIST_INTERFACE_VERSION);
-	g_engine = get_interface<sdk::IVEngineClient>("engine.dll", VENGINE_CLIENT_INTERFACE_VERSION);
-	g_model_info = get_interface<sdk::IVModelInfoClient>("engine.dll", VMODELINFO_CLIENT_INTERFACE_VERSION);
-	g_game_event_manager = get_interface<sdk::IGameEventManager2>("engine.dll", INTERFACEVERSION_GAMEEVENTSMANAGER2);
-	g_localize = get_interface<sdk::ILocalize>("localize.dll", ILOCALIZE_CLIENT_INTERFACE_VERSION);
-	g_input_system = get_interface<sdk::IInputSystem>("inputsystem.dll", INPUTSYSTEM_INTERFACE_VERSION);
-	g_engine_sound = get_interface<sdk::IEngineSound>("engine.dll", IENGINESOUND_CLIENT_INTERFACE_VERSION);
+	using affinity = task_graph::affinity;
 
-	g_client_state = *reinterpret_cast<sdk::CBaseClientState***>(get_vfunc<std::uintptr_t>(g_engine, 12) + 0x10);
+	// Steps that install hooks or touch the window stay on this thread, like
+	// before. Added in the old serial order, which run_serial still follows.
+	task_graph startup;
 
-	run_update_check();
+	const auto interfaces = add_step(startup, "Interface lookup", affinity::caller, []
+	{
+		g_client = get_interface<sdk::IBaseClientDLL>(get_client_name(), CLIENT_DLL_INTERFACE_VERSION);
+		g_entity_list = get_interface<sdk::IClientEntityList>(get_client_name(), VCLIENTENTITYLIST_INTERFACE_VERSION);
+		g_engine = get_interface<sdk::IVEngineClient>("engine.dll", VENGINE_CLIENT_INTERFACE_VERSION);
+		g_model_info = get_interface<sdk::IVModelInfoClient>("engine.dll", VMODELINFO_CLIENT_INTERFACE_VERSION);
+		g_game_event_manager = get_interface<sdk::IGameEventManager2>("engine.dll", INTERFACEVERSION_GAMEEVENTSMANAGER2);
+		g_localize = get_interface<sdk::ILocalize>("localize.dll", ILOCALIZE_CLIENT_INTERFACE_VERSION);
+		g_input_system = get_interface<sdk::IInputSystem>("inputsystem.dll", INPUTSYSTEM_INTERFACE_VERSION);
+		g_engine_sound = get_interface<sdk::IEngineSound>("engine.dll", IENGINESOUND_CLIENT_INTERFACE_VERSION);
+		g_mdl_cache = get_interface<IMDLCache>("datacache.dll", MDLCACHE_INTERFACE_VERSION);
+
+		g_client_state = *reinterpret_cast<sdk::CBaseClientState***>(get_vfunc<std::uintptr_t>(g_engine, 12) + 0x10);
+	});
+
+	// Steam's HTTP and call result APIs, kept on this thread like before
+	const auto update_check = add_step(startup, "run_update_check", affinity::caller, run_update_check, { interfaces });
 
 	// Get skins
-	game_data::initialize_kits();
+	const auto kits = add_step(startup, "initialize_kits", affinity::any, game_data::initialize_kits, { interfaces });
 
-	g_config.load();
+	// Resolving the kit indices reads the kit tables, so they have to be built first
+	const auto config_file = add_step(startup, "config::load", affinity::any, [] { g_config.load(); }, { kits });
 
-	render::initialize();
+	// The menu can open as soon as EndScene is hooked, and it lists kits and edits the config
+	const auto menu = add_step(startup, "render::initialize", affinity::caller, render::initialize, { kits, config_file });
 
 	// Model changer
-	g_mdl_cache = get_interface<IMDLCache>("datacache.dll", MDLCACHE_INTERFACE_VERSION);
-	model_changer::initialize();
-	hitmarker::initialize();
+	const auto models = add_step(startup, "model_changer::initialize", affinity::caller, model_changer::initialize, { interfaces });
+
+	const auto hit_events = add_step(startup, "hitmarker::initialize", affinity::caller, hitmarker::initialize, { config_file });
 
-	//g_client_hook = new vmt_smart_hook(g_client);
-	//g_client_hook->apply_hook<hooks::FrameStageNotify>(36);
+	const auto sequences = add_step(startup, "sequence_remap::load", affinity::any, sequence_remap::load);
+
+	// Baselines the config files as loaded above
+	const auto watch = add_step(startup, "hot_reload::initialize", affinity::any, hot_reload::initialize, { config_file, models });
+
+	add_step(startup, "Hook install", affinity::caller, []
+	{
+		// Drives the game thread side of model precaching
+		g_client_hook = new vmt_smart_hook(g_client);
+		g_client_hook->apply_hook<hooks::FrameStageNotify>(37);
 
-	//g_game_event_manager_hook = new vmt_smart_hook(g_game_event_manager);
-	//g_game_event_manager_hook->apply_hook<hooks::FireEventClientSide>(9);
+		//g_game_event_manager_hook = new vmt_smart_hook(g_game_event_manager);
+		//g_game_event_manager_hook->apply_hook<hooks::FireEventClientSide>(9);
 
-	const auto sequence_prop = sdk::C_BaseViewModel::GetSequenceProp();
-	g_sequence_hook = new recv_prop_hook(sequence_prop, &hooks::sequence_proxy_fn);
+		const auto sequence_prop = sdk::C_BaseViewModel::GetSequenceProp();
+		g_sequence_hook = new recv_prop_hook(sequence_prop, &hooks::sequence_proxy_fn);
 
-	const auto team_arr_prop = sdk::C_CS_PlayerResource::GetTeamProp();
-	const auto team_prop = team_arr_prop->m_pDataTable->m_pProps;
-	const auto proxy_addr = std::uintptr_t(team_prop->m_ProxyFn);
-	g_player_resource = *reinterpret_cast<sdk::C_CS_PlayerResource***>(proxy_addr + 0x10);
+		const auto team_arr_prop = sdk::C_CS_PlayerResource::GetTeamProp();
+		const auto team_prop = team_arr_prop->m_pDataTable->m_pProps;
+		const auto proxy_addr = std::uintptr_t(team_prop->m_ProxyFn);
+		g_player_resource = *reinterpret_cast<sdk::C_CS_PlayerResource***>(proxy_addr + 0x10);
+	}, { update_check, kits, config_file, menu, models, hit_events, sequences, watch });
+
+	const auto stats = k_parallel_startup ? startup.run_parallel() : startup.run_serial();
+	g_startup_timings.parallel = stats.parallel;
+	g_startup_timings.wall_ms = stats.wall_ms;
+	g_startup_timings.serial_ms = stats.task_ms;
+
+	// Startup is captured, hook activity only when asked for from the menu
+	trace::stop();
 }
 
 // If we aren't unloaded correctly (like when you close csgo)
@@ -138,10 +217,23 @@ auto uninitialize() -> void
 {
 	render::uninitialize();
 
-	//delete g_client_hook;
+	delete g_client_hook;
 	//delete g_game_event_manager_hook;
 
+	// Only instances whose vtable pointer is still ours get restored, anything
+	// freed and reused since is left alone
+	g_notice_hook.unhook_all();
+	g_player_hook.unhook_all();
+	remove_sticker_hooks();
+
 	model_changer::uninitialize();
 
 	delete g_sequence_hook;
+
+	// Scans and precaches are stopped above, the last config save still has to land
+	g_config.wait_for_save();
+	jobs::shutdown();
+
+	// FrameStageNotify is unhooked, nothing would run these
+	frame_scheduler::clear();
 }
@@ -26,6 +26,8 @@
 #include "SDK.hpp"
 #include "recv_proxy_hook.hpp"
 
+#include <atomic>
+
 template <typename T>
 auto get_entity_from_handle(sdk::CBaseHandle h) -> T*
 {
@@ -35,7 +37,23 @@ auto get_entity_from_handle(sdk::CBaseHandle h) -> T*
 	return static_cast<T*>(g_entity_list->GetClientEntityFromHandle(h));
 }
 
+// Hooks objects that only exist in game. Cheap when nothing changed since the
+// last install, game thread only.
 auto ensure_dynamic_hooks() -> void;
+
+// Bumped by the model changer whenever a map loads or unloads
+extern std::atomic<unsigned> g_level_generation;
+
+// How long initialize took, and the sum of its steps, which is about what
+// running them one after another costs
+struct startup_timings
+{
+	bool parallel = false;
+	double wall_ms = 0.0;
+	double serial_ms = 0.0;
+};
+
+extern startup_timings g_startup_timings;
 auto get_client_name() -> const char*;
 
 extern recv_prop_hook* g_sequence_hook;
\ No newline at end of file
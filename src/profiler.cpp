@@ -0,0 +1,214 @@
+#include "profiler.hpp"
+#include "Utilities/thread_slots.hpp"
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <mutex>
+
+namespace
+{
+	constexpr std::size_t k_hook_count = std::size_t(profiler::hook_id::count);
+
+	constexpr const char* k_hook_names[k_hook_count] =
+	{
+		"PostDataUpdate",
+		"Sequence proxy",
+		"FindMDL",
+		"EmitSound",
+		"Sticker attribute (float)",
+		"Sticker attribute (int)",
+		"FireGameEvent",
+		"Menu"
+	};
+
+	// A sample is the hook id in the top byte and the duration below it
+	constexpr auto k_duration_bits = 56;
+	constexpr auto k_duration_mask = (std::uint64_t(1) << k_duration_bits) - 1;
+
+	// Single producer (the owning thread), single consumer (collect)
+	constexpr std::uint32_t k_ring_size = 4096;
+
+	struct sample_ring
+	{
+		std::array<std::uint64_t, k_ring_size> samples;
+		std::atomic<std::uint32_t> head{ 0 };
+		std::atomic<std::uint32_t> tail{ 0 };
+		std::atomic<std::uint32_t> dropped{ 0 };
+	};
+
+	// Rings outlive their threads, only the game and render threads and a
+	// few workers ever record
+	std::mutex s_rings_mutex;
+	thread_slots<sample_ring, 32> s_rings;
+	std::atomic<std::uint32_t> s_unslotted{ 0 };
+
+	// Log scale: below 8 ns one bucket per ns, above that 8 buckets per power
+	// of two, so a bucket is at most 12.5% wide
+	constexpr auto k_sub_buckets = 8;
+	constexpr auto k_bucket_count = 8 + 40 * k_sub_buckets; // Up to about 18 minutes
+
+	auto bucket_of(const std::uint64_t nanoseconds) -> int
+	{
+		if(nanoseconds < k_sub_buckets)
+			return int(nanoseconds);
+
+		auto octave = 0;
+		for(auto v = nanoseconds; v > 1; v >>= 1)
+			++octave;
+
+		const auto sub = int(nanoseconds >> (octave - 3)) & (k_sub_buckets - 1);
+		const auto bucket = (octave - 2) * k_sub_buckets + sub;
+		return bucket < k_bucket_count ? bucket : k_bucket_count - 1;
+	}
+
+	// Middle of the bucket's range
+	auto bucket_value(const int bucket) -> double
+	{
+		if(bucket < k_sub_buckets)
+			return double(bucket);
+
+		const auto shift = bucket / k_sub_buckets - 1;
+		const auto lower = std::uint64_t(k_sub_buckets + bucket % k_sub_buckets) << shift;
+		return double(lower) + double(std::uint64_t(1) << shift) / 2.0;
+	}
+
+	struct histogram
+	{
+		std::array<std::uint64_t, k_bucket_count> buckets{};
+		std::uint64_t calls = 0;
+		std::uint64_t total_ns = 0;
+		std::uint64_t max_ns = 0;
+
+		auto add(const std::uint64_t nanoseconds) -> void
+		{
+			++buckets[bucket_of(nanoseconds)];
+			++calls;
+			total_ns += nanoseconds;
+			if(nanoseconds > max_ns)
+				max_ns = nanoseconds;
+		}
+
+		auto percentile(const double fraction) const -> double
+		{
+			if(!calls)
+				return 0.0;
+
+			const auto rank = std::uint64_t(fraction * double(calls - 1)) + 1;
+			auto seen = std::uint64_t(0);
+			for(auto i = 0; i < k_bucket_count; ++i)
+			{
+				seen += buckets[i];
+				if(seen >= rank)
+					return (std::min)(bucket_value(i), double(max_ns));
+			}
+
+			return double(max_ns);
+		}
+	};
+
+	// Held while draining, so collect and reset never interleave
+	std::mutex s_histograms_mutex;
+	std::array<histogram, k_hook_count> s_histograms;
+	std::uint64_t s_dropped = 0;
+
+	// Caller holds s_histograms_mutex
+	auto drain_rings() -> void
+	{
+		std::lock_guard<std::mutex> lock(s_rings_mutex);
+
+		s_rings.for_each([](sample_ring& ring, std::size_t)
+		{
+			const auto head = ring.head.load(std::memory_order_acquire);
+			auto tail = ring.tail.load(std::memory_order_relaxed);
+
+			for(; tail != head; ++tail)
+			{
+				const auto sample = ring.samples[tail & (k_ring_size - 1)];
+				const auto id = std::size_t(sample >> k_duration_bits);
+				if(id < k_hook_count)
+					s_histograms[id].add(sample & k_duration_mask);
+			}
+
+			ring.tail.store(tail, std::memory_order_release);
+			s_dropped += ring.dropped.exchange(0, std::memory_order_relaxed);
+		});
+
+		s_dropped += s_unslotted.exchange(0, std::memory_order_relaxed);
+	}
+}
+
+std::atomic<bool> profiler::g_enabled{ false };
+
+auto profiler::record(const hook_id id, const std::uint64_t nanoseconds) -> void
+{
+	const auto ring = s_rings.get();
+	if(!ring)
+	{
+		s_unslotted.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	const auto head = ring->head.load(std::memory_order_relaxed);
+	const auto tail = ring->tail.load(std::memory_order_acquire);
+	if(head - tail >= k_ring_size)
+	{
+		ring->dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	ring->samples[head & (k_ring_size - 1)] = std::uint64_t(id) << k_duration_bits | (std::min)(nanoseconds, k_duration_mask);
+	ring->head.store(head + 1, std::memory_order_release);
+}
+
+auto profiler::get_name(const hook_id id) -> const char*
+{
+	const auto index = std::size_t(id);
+	return index < k_hook_count ? k_hook_names[index] : "";
+}
+
+auto profiler::collect() -> void
+{
+	std::lock_guard<std::mutex> lock(s_histograms_mutex);
+	drain_rings();
+}
+
+auto profiler::get_stats() -> std::vector<hook_stats>
+{
+	std::lock_guard<std::mutex> lock(s_histograms_mutex);
+	drain_rings();
+
+	std::vector<hook_stats> result(k_hook_count);
+	for(auto i = std::size_t(0); i < k_hook_count; ++i)
+	{
+		const auto& histogram = s_histograms[i];
+		auto& stats = result[i];
+
+		stats.name = k_hook_names[i];
+		stats.calls = histogram.calls;
+		stats.total_ms = double(histogram.total_ns) / 1000000.0;
+		stats.average_us = histogram.calls ? double(histogram.total_ns) / double(histogram.calls) / 1000.0 : 0.0;
+		stats.p50_us = histogram.percentile(0.50) / 1000.0;
+		stats.p99_us = histogram.percentile(0.99) / 1000.0;
+		stats.max_us = double(histogram.max_ns) / 1000.0;
+	}
+
+	return result;
+}
+
+auto profiler::get_dropped() -> std::uint64_t
+{
+	std::lock_guard<std::mutex> lock(s_histograms_mutex);
+	return s_dropped;
+}
+
+auto profiler::reset() -> void
+{
+	std::lock_guard<std::mutex> lock(s_histograms_mutex);
+
+	// Drain first so samples taken before the reset don't show up after it
+	drain_rings();
+
+	s_histograms = {};
+	s_dropped = 0;
+}
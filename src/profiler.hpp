@@ -0,0 +1,104 @@
+#pragma once
+#include "trace.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// Latency of our hooks. Each thread writes its samples into its own ring
+// buffer without locking; collect() drains them into per-hook histograms.
+// While a trace is recording the same timers also add trace spans.
+namespace profiler
+{
+	enum class hook_id : std::uint8_t
+	{
+		post_data_update,
+		sequence_proxy,
+		find_mdl,
+		emit_sound,
+		sticker_float,
+		sticker_int,
+		fire_game_event,
+		draw_gui,
+		count
+	};
+
+	// Off by default, the timers cost two clock reads per call
+	extern std::atomic<bool> g_enabled;
+
+	using clock = trace::clock; // steady_clock, QueryPerformanceCounter on MSVC
+
+	// Any thread
+	auto record(hook_id id, std::uint64_t nanoseconds) -> void;
+
+	auto get_name(hook_id id) -> const char*;
+
+	class scoped_timer
+	{
+	public:
+		explicit scoped_timer(const hook_id id)
+			: m_id(id)
+			, m_profile(g_enabled.load(std::memory_order_relaxed))
+			, m_trace(trace::is_recording())
+		{
+			if(m_profile || m_trace)
+				m_start = clock::now();
+		}
+
+		~scoped_timer()
+		{
+			stop();
+		}
+
+		scoped_timer(const scoped_timer&) = delete;
+		auto operator=(const scoped_timer&) -> scoped_timer& = delete;
+
+		// Ends the measurement early, e.g. before forwarding to the original
+		auto stop() -> void
+		{
+			if(!m_profile && !m_trace)
+				return;
+
+			const auto end = clock::now();
+
+			if(m_profile)
+				record(m_id, std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(end - m_start).count()));
+
+			if(m_trace)
+				trace::add_span(get_name(m_id), m_start, end);
+
+			m_profile = false;
+			m_trace = false;
+		}
+
+	private:
+		hook_id m_id;
+		bool m_profile;
+		bool m_trace;
+		clock::time_point m_start;
+	};
+
+	struct hook_stats
+	{
+		const char* name = "";
+		std::uint64_t calls = 0;
+		double total_ms = 0.0;
+		double average_us = 0.0;
+		double p50_us = 0.0;
+		double p99_us = 0.0;
+		double max_us = 0.0;
+	};
+
+	// Drains every thread's ring into the histograms. Called once a frame from
+	// the render thread so the rings don't overflow while the menu is closed.
+	auto collect() -> void;
+
+	// Collects first. One entry per hook_id, in order.
+	auto get_stats() -> std::vector<hook_stats>;
+
+	// Samples lost because a ring was full
+	auto get_dropped() -> std::uint64_t;
+
+	auto reset() -> void;
+}
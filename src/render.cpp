@@ -26,6 +26,7 @@
 #include "SDK.hpp"
 #include "Utilities/platform.hpp"
 #include "hitmarker.hpp"
+#include "profiler.hpp"
 
 // Renderer for windows. Maybe sometime i'll make a linux one
 
@@ -235,6 +236,8 @@ namespace render
 				//state.load(thisptr);
 				state->Apply();
 				state->Release();
+
+				profiler::collect();
 			}
 
 			return m_original(thisptr);
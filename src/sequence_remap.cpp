@@ -0,0 +1,376 @@
+#include "sequence_remap.hpp"
+#include "mdl_parser.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+namespace
+{
+	constexpr auto k_data_file = "nSkinz_sequences.json";
+
+	// Sequence numbers are for a default knife as the source. Entries are a
+	// sequence, a [low, high] range or {"any": [...]}; unlisted sequences get
+	// the offset added.
+	constexpr auto k_default_tables = R"json({
+	"version": 1,
+	"tables": [
+		{
+			"models": [ "models/weapons/v_knife_butterfly.mdl" ],
+			"offset": 1,
+			"sequences": { "0": [ 0, 1 ], "12": [ 13, 15 ] }
+		},
+		{
+			"models": [ "models/weapons/v_knife_falchion_advanced.mdl" ],
+			"offset": -1,
+			"sequences": { "0": 0, "1": 1, "2": 1, "9": [ 8, 9 ], "12": [ 12, 13 ] }
+		},
+		{
+			"models": [ "models/weapons/v_knife_css.mdl" ],
+			"offset": 0,
+			"sequences": { "12": { "any": [ 12, 15 ] } }
+		},
+		{
+			"models": [ "models/weapons/v_knife_push.mdl" ],
+			"offset": 2,
+			"sequences": { "0": 0, "1": 1, "2": 1, "3": [ 2, 6 ], "4": [ 2, 6 ], "9": [ 11, 12 ], "10": 13, "11": 14, "12": 15 }
+		},
+		{
+			"models": [ "models/weapons/v_knife_survival_bowie.mdl" ],
+			"offset": -1,
+			"sequences": { "0": 0, "1": 1, "2": 1 }
+		},
+		{
+			"models": [
+				"models/weapons/v_knife_ursus.mdl",
+				"models/weapons/v_knife_cord.mdl",
+				"models/weapons/v_knife_canis.mdl",
+				"models/weapons/v_knife_outdoor.mdl",
+				"models/weapons/v_knife_skeleton.mdl"
+			],
+			"offset": 1,
+			"sequences": { "0": [ 0, 1 ], "12": [ 13, 14 ] }
+		},
+		{
+			"models": [ "models/weapons/v_knife_stiletto.mdl" ],
+			"offset": 0,
+			"sequences": { "12": [ 12, 13 ] }
+		},
+		{
+			"models": [ "models/weapons/v_knife_widowmaker.mdl" ],
+			"offset": 0,
+			"sequences": { "12": [ 14, 15 ] }
+		}
+	]
+}
+)json";
+
+	std::mutex s_mutex;
+	std::shared_ptr<const sequence_remap::table_map> s_tables = std::make_shared<const sequence_remap::table_map>();
+	std::string s_status = "Not loaded";
+
+	struct generated_table
+	{
+		bool valid = false;
+		sequence_remap::table remap;
+	};
+
+	// Game thread only, reset from there after a reload asks for it
+	std::map<std::pair<fnv::hash, fnv::hash>, generated_table> s_generated;
+	std::atomic<bool> s_clear_generated{ false };
+	std::atomic<int> s_generated_count{ 0 };
+
+	auto pick(const sequence_remap::entry& entry, const int sequence) -> int
+	{
+		if(entry.count == 0)
+			return sequence;
+
+		return entry.choices[entry.count == 1 ? 0 : rand() % entry.count];
+	}
+
+	auto to_upper(std::string text) -> std::string
+	{
+		std::transform(text.begin(), text.end(), text.begin(), [](const unsigned char c)
+		{
+			return char(std::toupper(c));
+		});
+		return text;
+	}
+
+	auto check_sequence(const int sequence) -> std::uint8_t
+	{
+		if(sequence < 0 || sequence > 0xFF)
+			throw std::runtime_error("sequence " + std::to_string(sequence) + " is out of range");
+		return std::uint8_t(sequence);
+	}
+
+	auto add_choice(sequence_remap::entry& out, const int sequence) -> void
+	{
+		if(out.count == sequence_remap::k_max_choices)
+			throw std::runtime_error("an entry can have at most " + std::to_string(sequence_remap::k_max_choices) + " choices");
+		out.choices[out.count++] = check_sequence(sequence);
+	}
+
+	auto parse_entry(const json& j) -> sequence_remap::entry
+	{
+		sequence_remap::entry out;
+
+		if(j.is_number_integer())
+			add_choice(out, j.get<int>());
+		else if(j.is_array())
+		{
+			if(j.size() != 2)
+				throw std::runtime_error("a range must be [low, high]");
+			const auto low = j.at(0).get<int>();
+			const auto high = j.at(1).get<int>();
+			if(low > high)
+				throw std::runtime_error("a range must be [low, high]");
+			for(auto sequence = low; sequence <= high; ++sequence)
+				add_choice(out, sequence);
+		}
+		else if(j.is_object() && j.contains("any"))
+		{
+			for(const auto& sequence : j.at("any"))
+				add_choice(out, sequence.get<int>());
+		}
+
+		if(out.count == 0)
+			throw std::runtime_error("an entry must be a sequence, a [low, high] range or {\"any\": [...]}");
+
+		return out;
+	}
+
+	auto parse_table(const json& j) -> sequence_remap::table
+	{
+		sequence_remap::table out;
+
+		const auto offset = j.value("offset", 0);
+		for(auto sequence = 0; sequence < sequence_remap::k_max_sequences; ++sequence)
+		{
+			// Like the old "sequence - 1" cases, which never went below zero in practice
+			if(offset != 0 && sequence + offset >= 0)
+				add_choice(out.entries[sequence], sequence + offset);
+		}
+
+		if(j.contains("sequences"))
+		{
+			for(const auto& it : j.at("sequences").items())
+			{
+				const auto sequence = std::stoi(it.key());
+				if(sequence < 0 || sequence >= sequence_remap::k_max_sequences)
+					throw std::runtime_error("source sequence " + it.key() + " is out of range");
+				out.entries[sequence] = parse_entry(it.value());
+			}
+		}
+
+		return out;
+	}
+
+	auto set_status(std::shared_ptr<const sequence_remap::table_map> tables, std::string status) -> void
+	{
+		std::lock_guard<std::mutex> lock(s_mutex);
+		if(tables)
+			s_tables = std::move(tables);
+		s_status = std::move(status);
+	}
+}
+
+auto sequence_remap::parse_tables(const std::string& text, table_map& out) -> void
+{
+	const auto j = json::parse(text);
+	if(j.value("version", 0) != 1)
+		throw std::runtime_error("unsupported version");
+
+	for(const auto& table_json : j.at("tables"))
+	{
+		const auto parsed = parse_table(table_json);
+		for(const auto& model : table_json.at("models"))
+			out[fnv::hash_runtime(model.get<std::string>().c_str())] = parsed;
+	}
+}
+
+auto sequence_remap::load() -> void
+{
+	auto tables = std::make_shared<table_map>();
+
+	try
+	{
+		parse_tables(k_default_tables, *tables);
+	}
+	catch(const std::exception& e)
+	{
+		set_status(nullptr, std::string("Built-in tables are broken: ") + e.what());
+		return;
+	}
+
+	auto file = std::ifstream(k_data_file);
+	if(!file.good())
+	{
+		// Give users something to edit
+		auto of = std::ofstream(k_data_file);
+		of << k_default_tables;
+
+		set_status(std::move(tables), "Using built-in tables, wrote them to " + std::string(k_data_file));
+		return;
+	}
+
+	std::stringstream text;
+	text << file.rdbuf();
+
+	try
+	{
+		parse_tables(text.str(), *tables);
+	}
+	catch(const std::exception& e)
+	{
+		// Drop the partly merged file tables
+		tables->clear();
+		parse_tables(k_default_tables, *tables);
+		set_status(std::move(tables), std::string(k_data_file) + " is invalid, using built-in tables: " + e.what());
+		return;
+	}
+
+	const auto count = tables->size();
+	set_status(std::move(tables), "Loaded tables for " + std::to_string(count) + " knife models");
+
+	// Models may have changed on disk as well
+	s_clear_generated = true;
+}
+
+auto sequence_remap::get_tables() -> std::shared_ptr<const table_map>
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+	return s_tables;
+}
+
+auto sequence_remap::get_status() -> std::string
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+	return s_status;
+}
+
+auto sequence_remap::has_table(const fnv::hash model) -> bool
+{
+	return get_tables()->count(model) != 0;
+}
+
+auto sequence_remap::remap(const fnv::hash model, const int sequence) -> int
+{
+	if(sequence < 0 || sequence >= k_max_sequences)
+		return sequence;
+
+	const auto tables = get_tables();
+	const auto it = tables->find(model);
+	if(it == tables->end())
+		return sequence;
+
+	return pick(it->second.entries[sequence], sequence);
+}
+
+auto sequence_remap::build_activity_table(const void* source, const std::size_t source_size,
+	const void* target, const std::size_t target_size, table& out) -> bool
+{
+	std::vector<mdl::sequence_info> source_sequences;
+	std::vector<mdl::sequence_info> target_sequences;
+	if(mdl::parse_sequences(source, source_size, source_sequences) != mdl::parse_status::ok
+		|| mdl::parse_sequences(target, target_size, target_sequences) != mdl::parse_status::ok)
+		return false;
+
+	// Sequences with no weight are never picked for their activity by the
+	// engine either, unless all of them have none
+	std::unordered_map<std::string, std::vector<std::pair<int, int>>> by_activity;
+	for(auto i = 0; i < int(target_sequences.size()) && i <= 0xFF; ++i)
+	{
+		const auto& sequence = target_sequences[i];
+		if(!sequence.activity.empty())
+			by_activity[to_upper(sequence.activity)].emplace_back(i, sequence.activity_weight);
+	}
+
+	out = table();
+
+	auto matched = 0;
+	const auto count = (std::min)(int(source_sequences.size()), k_max_sequences);
+	for(auto i = 0; i < count; ++i)
+	{
+		if(source_sequences[i].activity.empty())
+			continue;
+
+		const auto activity = to_upper(source_sequences[i].activity);
+
+		// Same layout up to here, keep the exact sequence rather than picking
+		// between variants like idles and inspects
+		if(i < int(target_sequences.size()) && to_upper(target_sequences[i].activity) == activity)
+		{
+			out.entries[i].choices[out.entries[i].count++] = std::uint8_t(i);
+			++matched;
+			continue;
+		}
+
+		const auto it = by_activity.find(activity);
+		if(it == by_activity.end())
+			continue;
+
+		const auto any_weighted = std::any_of(it->second.begin(), it->second.end(), [](const std::pair<int, int>& candidate)
+		{
+			return candidate.second > 0;
+		});
+
+		auto& entry = out.entries[i];
+		for(const auto& candidate : it->second)
+		{
+			if(entry.count == k_max_choices)
+				break;
+			if(!any_weighted || candidate.second > 0)
+				entry.choices[entry.count++] = std::uint8_t(candidate.first);
+		}
+
+		++matched;
+	}
+
+	return matched > 0;
+}
+
+auto sequence_remap::remap_by_activity(const fnv::hash source_model, const void* source_header,
+	const fnv::hash target_model, const void* target_header, const int sequence) -> int
+{
+	if(sequence < 0 || sequence >= k_max_sequences || !source_header || !target_header)
+		return sequence;
+
+	if(s_clear_generated.exchange(false))
+	{
+		s_generated.clear();
+		s_generated_count = 0;
+	}
+
+	const auto key = std::make_pair(source_model, target_model);
+	auto it = s_generated.find(key);
+	if(it == s_generated.end())
+	{
+		generated_table generated;
+		const auto source_length = mdl::get_length(source_header);
+		const auto target_length = mdl::get_length(target_header);
+		generated.valid = source_length && target_length
+			&& build_activity_table(source_header, source_length, target_header, target_length, generated.remap);
+
+		if(generated.valid)
+			++s_generated_count;
+
+		it = s_generated.emplace(key, generated).first;
+	}
+
+	return it->second.valid ? pick(it->second.remap.entries[sequence], sequence) : sequence;
+}
+
+auto sequence_remap::get_generated_count() -> int
+{
+	return s_generated_count;
+}
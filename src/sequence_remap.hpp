@@ -0,0 +1,67 @@
+#pragma once
+#include "Utilities/fnv_hash.hpp"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+// Knife view model sequence remapping. The server plays the default knife's
+// sequences, so with a knife override they have to be translated to the
+// sequences of the model we show. Each model has a flat table indexed by the
+// source sequence, loaded from nSkinz_sequences.json over built-in defaults.
+//
+// Models without a table, like custom knives from the model changer, get one
+// generated from the activities in the two models' sequence descriptors: a
+// source sequence plays one of the target sequences with the same activity.
+namespace sequence_remap
+{
+	// Sequences past the end of a table are passed through unchanged
+	constexpr int k_max_sequences = 32;
+	constexpr int k_max_choices = 7;
+
+	// One of the choices is picked at random, none means unchanged
+	struct entry
+	{
+		std::uint8_t count = 0;
+		std::array<std::uint8_t, k_max_choices> choices{};
+	};
+
+	struct table
+	{
+		std::array<entry, k_max_sequences> entries;
+	};
+
+	// Keyed by fnv::hash_runtime of the model path
+	using table_map = std::unordered_map<fnv::hash, table>;
+
+	// Adds the tables described by text to out, replacing tables of the same
+	// model. Throws std::exception with a description when the text is invalid.
+	auto parse_tables(const std::string& text, table_map& out) -> void;
+
+	// Built-in tables, then the data file, which is created from the built-in
+	// ones when missing. Safe to call again while the game is running.
+	auto load() -> void;
+
+	auto get_tables() -> std::shared_ptr<const table_map>;
+	auto get_status() -> std::string;
+
+	auto has_table(fnv::hash model) -> bool;
+	auto remap(fnv::hash model, int sequence) -> int;
+
+	// Maps every source sequence to the target sequences sharing its activity.
+	// Takes the contents of two .mdl files. False if either can't be read or
+	// no activity matched.
+	auto build_activity_table(const void* source, std::size_t source_size,
+		const void* target, std::size_t target_size, table& out) -> bool;
+
+	// remap with a table built by build_activity_table from two studio headers
+	// in engine memory. Tables are cached per pair of model hashes, failures
+	// too. Game thread only.
+	auto remap_by_activity(fnv::hash source_model, const void* source_header,
+		fnv::hash target_model, const void* target_header, int sequence) -> int;
+
+	// Tables built by remap_by_activity so far, failures not counted
+	auto get_generated_count() -> int;
+}
@@ -22,9 +22,12 @@
 * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 * SOFTWARE.
 */
+#include <atomic>
 #include <cstring>
 #include "SDK.hpp"
 #include "config.hpp"
+#include "profiler.hpp"
+#include "sticker_table.hpp"
 
 enum class EStickerAttributeType
 {
@@ -36,32 +39,66 @@ enum class EStickerAttributeType
 
 static auto s_econ_item_interface_wrapper_offset = std::uint16_t(0);
 
+// Shared by the econ item interface of every weapon we touched
+static vmt_multi_hook s_sticker_hook;
+
+using sticker_attributes = sticker_table::attributes;
+
+// Rebuilt into the table not being read, then swapped in
+static sticker_table s_sticker_tables[2];
+static std::atomic<const sticker_table*> s_sticker_table{ nullptr };
+static auto s_sticker_table_generation = 0u;
+
+// Null if the item has no config for this slot
+static auto get_sticker_attributes(const int defindex, const int slot) -> const sticker_attributes*
+{
+	if(slot < 0 || slot >= sticker_table::k_slots)
+		return nullptr;
+
+	const auto table = s_sticker_table.load(std::memory_order_acquire);
+	if(table && sticker_table::covers(defindex))
+		return table->find(defindex, slot);
+
+	// Before the first frame, or an item the table doesn't cover
+	const auto config = g_config.get_by_definition_index(defindex);
+	if(!config)
+		return nullptr;
+
+	// Only the game thread asks
+	static sticker_attributes attributes;
+	const auto& sticker = config->stickers[slot];
+	attributes = { sticker.kit, sticker.wear, sticker.scale, sticker.rotation };
+	return &attributes;
+}
+
 struct GetStickerAttributeBySlotIndexFloat
 {
 	static auto __fastcall hooked(void* thisptr, void*, const int slot,
 		const EStickerAttributeType attribute, const float unknown) -> float
 	{
+		profiler::scoped_timer timer(profiler::hook_id::sticker_float);
+
 		auto item = reinterpret_cast<sdk::C_BaseAttributableItem*>(std::uintptr_t(thisptr) - s_econ_item_interface_wrapper_offset);
 
 		const auto defindex = item->GetItemDefinitionIndex();
 
-		auto config = g_config.get_by_definition_index(defindex);
-
-		if(config)
+		if(const auto sticker = get_sticker_attributes(defindex, slot))
 		{
 			switch(attribute)
 			{
 			case EStickerAttributeType::Wear:
-				return config->stickers.at(slot).wear;
+				return sticker->wear;
 			case EStickerAttributeType::Scale:
-				return config->stickers.at(slot).scale;
+				return sticker->scale;
 			case EStickerAttributeType::Rotation:
-				return config->stickers.at(slot).rotation;
+				return sticker->rotation;
 			default:
 				break;
 			}
 		}
 
+		timer.stop();
+		s_sticker_hook.count_forward();
 		return m_original(thisptr, nullptr, slot, attribute, unknown);
 	}
 
@@ -75,18 +112,20 @@ struct GetStickerAttributeBySlotIndexInt
 	static auto __fastcall hooked(void* thisptr, void*, const int slot,
 		const EStickerAttributeType attribute, const int unknown) -> int
 	{
+		profiler::scoped_timer timer(profiler::hook_id::sticker_int);
+
 		auto item = reinterpret_cast<sdk::C_BaseAttributableItem*>(std::uintptr_t(thisptr) - s_econ_item_interface_wrapper_offset);
 
 		if(attribute == EStickerAttributeType::Index)
 		{
 			const auto defindex = item->GetItemDefinitionIndex();
 
-			auto config = g_config.get_by_definition_index(defindex);
-
-			if(config)
-				return config->stickers.at(slot).kit;
+			if(const auto sticker = get_sticker_attributes(defindex, slot))
+				return sticker->kit;
 		}
 
+		timer.stop();
+		s_sticker_hook.count_forward();
 		return m_original(thisptr, nullptr, slot, attribute, unknown);
 	}
 
@@ -95,18 +134,40 @@ struct GetStickerAttributeBySlotIndexInt
 
 decltype(GetStickerAttributeBySlotIndexInt::m_original) GetStickerAttributeBySlotIndexInt::m_original;
 
+auto update_sticker_table() -> void
+{
+	const auto generation = g_config.get_generation();
+	const auto current = s_sticker_table.load(std::memory_order_relaxed);
+	if(current && generation == s_sticker_table_generation)
+		return;
+
+	auto& table = current == &s_sticker_tables[0] ? s_sticker_tables[1] : s_sticker_tables[0];
+	table.build(g_config.get_items());
+
+	s_sticker_table_generation = generation;
+	s_sticker_table.store(&table, std::memory_order_release);
+}
+
 auto apply_sticker_changer(sdk::C_BaseAttributableItem* item) -> void
 {
 	if(!s_econ_item_interface_wrapper_offset)
 		s_econ_item_interface_wrapper_offset = netvar_manager::get().get_offset(FNV("CBaseAttributableItem->m_Item")) + 0xC;
 
-	static vmt_multi_hook hook;
-
 	const auto econ_item_interface_wrapper = std::uintptr_t(item) + s_econ_item_interface_wrapper_offset;
 
-	if(hook.initialize_and_hook_instance(reinterpret_cast<void*>(econ_item_interface_wrapper)))
+	if(s_sticker_hook.initialize_and_hook_instance(reinterpret_cast<void*>(econ_item_interface_wrapper)))
 	{
-		hook.apply_hook<GetStickerAttributeBySlotIndexFloat>(4);
-		hook.apply_hook<GetStickerAttributeBySlotIndexInt>(5);
+		s_sticker_hook.apply_hook<GetStickerAttributeBySlotIndexFloat>(4);
+		s_sticker_hook.apply_hook<GetStickerAttributeBySlotIndexInt>(5);
 	}
-}
\ No newline at end of file
+}
+
+auto get_sticker_hook_stats() -> vmt_multi_hook::stats
+{
+	return s_sticker_hook.get_stats();
+}
+
+auto remove_sticker_hooks() -> std::size_t
+{
+	return s_sticker_hook.unhook_all();
+}
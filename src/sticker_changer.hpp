@@ -25,4 +25,13 @@
 #pragma once
 #include "SDK.hpp"
 
-extern auto apply_sticker_changer(sdk::C_BaseAttributableItem* item) -> void;
\ No newline at end of file
+extern auto apply_sticker_changer(sdk::C_BaseAttributableItem* item) -> void;
+
+// Rebuilds the sticker attributes the hooks return when the config changed.
+// Game thread, once per frame.
+extern auto update_sticker_table() -> void;
+
+// Every weapon gets its econ item interface hooked once, these are for the
+// statistics and for restoring them all before unloading
+extern auto get_sticker_hook_stats() -> vmt_multi_hook::stats;
+extern auto remove_sticker_hooks() -> std::size_t;
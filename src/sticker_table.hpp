@@ -0,0 +1,70 @@
+#pragma once
+#include "config.hpp"
+
+#include <array>
+#include <cstddef>
+#include <tuple>
+#include <vector>
+
+// The game asks for every attribute of every slot whenever it draws a
+// stickered weapon, so the config is flattened into a table it can index.
+// Definition indices past the table (knives and gloves) aren't covered and
+// take the config lookup instead.
+class sticker_table
+{
+public:
+	static constexpr auto k_definitions = 128;
+	static constexpr auto k_slots = int(std::tuple_size<decltype(item_setting::stickers)>::value);
+
+	struct attributes
+	{
+		int kit;
+		float wear;
+		float scale;
+		float rotation;
+	};
+
+	static auto covers(const int definition_index) -> bool
+	{
+		return definition_index >= 0 && definition_index < k_definitions;
+	}
+
+	// First enabled item wins, like config::get_by_definition_index
+	auto build(const std::vector<item_setting>& items) -> void
+	{
+		m_rows = {};
+
+		for(const auto& item : items)
+		{
+			if(!item.enabled || !covers(item.definition_index))
+				continue;
+
+			auto& row = m_rows[item.definition_index];
+			if(row.configured)
+				continue;
+
+			row.configured = true;
+			for(auto i = 0; i < k_slots; ++i)
+			{
+				const auto& sticker = item.stickers[i];
+				row.slots[i] = { sticker.kit, sticker.wear, sticker.scale, sticker.rotation };
+			}
+		}
+	}
+
+	// Null if the item has no config. Only for covered definitions and valid slots.
+	auto find(const int definition_index, const int slot) const -> const attributes*
+	{
+		const auto& row = m_rows[definition_index];
+		return row.configured ? &row.slots[slot] : nullptr;
+	}
+
+private:
+	struct row
+	{
+		bool configured;
+		std::array<attributes, k_slots> slots;
+	};
+
+	std::array<row, k_definitions> m_rows;
+};
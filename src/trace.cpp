@@ -0,0 +1,204 @@
+#include "trace.hpp"
+#include "Utilities/jobs.hpp"
+#include "Utilities/thread_slots.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+namespace
+{
+	// About 24 MB of events, a few minutes of busy hooks
+	constexpr std::size_t k_max_events = 1 << 20;
+
+	struct event
+	{
+		const char* name;
+		std::int64_t begin_ns; // Since s_epoch
+		std::int64_t duration_ns;
+	};
+
+	// Each thread appends to its own buffer, the lock is only contended while
+	// saving or clearing
+	struct thread_buffer
+	{
+		std::mutex mutex;
+		std::vector<event> events;
+	};
+
+	const auto s_epoch = trace::clock::now();
+
+	// Enough for every pool worker besides the game's threads
+	std::mutex s_buffers_mutex;
+	thread_slots<thread_buffer, 64> s_buffers;
+
+	std::atomic<std::size_t> s_event_count{ 0 };
+	std::atomic<std::size_t> s_dropped{ 0 };
+
+	std::atomic<bool> s_saving{ false };
+	std::mutex s_save_status_mutex;
+	std::string s_save_status;
+
+	auto since_epoch(const trace::clock::time_point time) -> std::int64_t
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(time - s_epoch).count();
+	}
+
+	auto set_save_status(std::string status) -> void
+	{
+		std::lock_guard<std::mutex> lock(s_save_status_mutex);
+		s_save_status = std::move(status);
+	}
+
+	// On a pool job, a full trace takes a while to serialize. One list per thread.
+	auto write_trace(const std::string& path, const std::vector<std::vector<event>>& threads) -> bool
+	{
+		auto events = json::array();
+
+		for(auto index = std::size_t(0); index < threads.size(); ++index)
+		{
+			// Numbered in order of first event, trace viewers only need them distinct
+			const auto tid = int(index) + 1;
+
+			// Complete events ("X") are a begin and an end in one record
+			for(const auto& e : threads[index])
+			{
+				events.push_back({
+					{ "name", e.name },
+					{ "ph", "X" },
+					{ "ts", double(e.begin_ns) / 1000.0 },
+					{ "dur", double(e.duration_ns) / 1000.0 },
+					{ "pid", 1 },
+					{ "tid", tid }
+				});
+			}
+		}
+
+		events.push_back({
+			{ "name", "process_name" },
+			{ "ph", "M" },
+			{ "pid", 1 },
+			{ "args", { { "name", "nSkinz" } } }
+		});
+
+		const json j = {
+			{ "traceEvents", std::move(events) },
+			{ "displayTimeUnit", "ms" }
+		};
+
+		auto of = std::ofstream(path);
+		of << j.dump();
+		return of.good();
+	}
+}
+
+std::atomic<bool> trace::g_recording{ true };
+
+auto trace::add_span(const char* name, const clock::time_point begin, const clock::time_point end) -> void
+{
+	if(s_event_count.fetch_add(1, std::memory_order_relaxed) >= k_max_events)
+	{
+		s_event_count.fetch_sub(1, std::memory_order_relaxed);
+		s_dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	const auto buffer = s_buffers.get();
+	if(!buffer)
+	{
+		s_event_count.fetch_sub(1, std::memory_order_relaxed);
+		s_dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(buffer->mutex);
+	buffer->events.push_back({ name, since_epoch(begin), std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() });
+}
+
+auto trace::start() -> void
+{
+	g_recording = true;
+}
+
+auto trace::stop() -> void
+{
+	g_recording = false;
+}
+
+auto trace::clear() -> void
+{
+	std::lock_guard<std::mutex> lock(s_buffers_mutex);
+
+	s_buffers.for_each([](thread_buffer& buffer, std::size_t)
+	{
+		std::lock_guard<std::mutex> buffer_lock(buffer.mutex);
+		buffer.events.clear();
+		buffer.events.shrink_to_fit();
+	});
+
+	s_event_count = 0;
+	s_dropped = 0;
+}
+
+auto trace::get_event_count() -> std::size_t
+{
+	return s_event_count.load(std::memory_order_relaxed);
+}
+
+auto trace::get_dropped() -> std::size_t
+{
+	return s_dropped.load(std::memory_order_relaxed);
+}
+
+auto trace::save(std::string path) -> bool
+{
+	if(s_saving.exchange(true))
+		return false;
+
+	// Only the copy happens on the calling thread, it's a plain memcpy per thread
+	std::vector<std::vector<event>> threads;
+	{
+		std::lock_guard<std::mutex> lock(s_buffers_mutex);
+
+		s_buffers.for_each([&threads](thread_buffer& buffer, std::size_t)
+		{
+			std::lock_guard<std::mutex> buffer_lock(buffer.mutex);
+			threads.push_back(buffer.events);
+		});
+	}
+
+	const auto posted = jobs::post([path = std::move(path), threads = std::move(threads)]
+	{
+		auto saved = false;
+		try
+		{
+			saved = write_trace(path, threads);
+		}
+		catch(const std::exception&)
+		{
+		}
+
+		set_save_status(saved ? "Saved " + path : "Couldn't write " + path);
+		s_saving = false;
+	});
+
+	if(!posted)
+		s_saving = false;
+	return posted;
+}
+
+auto trace::is_saving() -> bool
+{
+	return s_saving;
+}
+
+auto trace::get_save_status() -> std::string
+{
+	std::lock_guard<std::mutex> lock(s_save_status_mutex);
+	return s_save_status;
+}
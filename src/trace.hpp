@@ -0,0 +1,69 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+// Timeline of startup and hook activity, saved as Chrome trace event JSON
+// that chrome://tracing and Perfetto open. Recording starts at load so the
+// startup phases are captured, initialize() stops it when it's done.
+namespace trace
+{
+	using clock = std::chrono::steady_clock;
+
+	extern std::atomic<bool> g_recording;
+
+	inline auto is_recording() -> bool
+	{
+		return g_recording.load(std::memory_order_relaxed);
+	}
+
+	// A finished span on the calling thread. The name has to outlive the
+	// trace, string literals only.
+	auto add_span(const char* name, clock::time_point begin, clock::time_point end) -> void;
+
+	class scope
+	{
+	public:
+		explicit scope(const char* name)
+			: m_name(name)
+			, m_active(is_recording())
+		{
+			if(m_active)
+				m_begin = clock::now();
+		}
+
+		~scope()
+		{
+			if(m_active)
+				add_span(m_name, m_begin, clock::now());
+		}
+
+		scope(const scope&) = delete;
+		auto operator=(const scope&) -> scope& = delete;
+
+	private:
+		const char* m_name;
+		bool m_active;
+		clock::time_point m_begin;
+	};
+
+	auto start() -> void;
+	auto stop() -> void;
+
+	// Drops everything recorded so far, startup included
+	auto clear() -> void;
+
+	auto get_event_count() -> std::size_t;
+
+	// Events not recorded because the trace was full
+	auto get_dropped() -> std::size_t;
+
+	// Copies what was recorded so far and writes it on a pool job. False if a
+	// save is still running or the pool is shutting down.
+	auto save(std::string path) -> bool;
+	auto is_saving() -> bool;
+
+	// How the last finished save went, empty before the first
+	auto get_save_status() -> std::string;
+}
@@ -25,6 +25,7 @@
 #include "update_check.hpp"
 #include "Utilities/platform.hpp"
 #include "SDK/declarations.hpp"
+#include "Utilities/jobs.hpp"
 
 #include <ctime>
 #include <nlohmann/json.hpp>
@@ -164,7 +165,7 @@ protected:
 
 static VersionCheckCallback s_check_callback;
 
-bool g_update_needed = false;
+std::atomic<bool> g_update_needed{ false };
 std::vector<commit_entry> g_commits_since_compile;
 
 void from_json(const json& j, commit_entry& commit)
@@ -189,15 +190,19 @@ void VersionCheckCallback::Run(HTTPRequestCompleted_t* pvParam)
 
 		body_cstr[pvParam->m_unBodySize] = 0;
 
-		try
+		// The callback runs on the game thread, parsing a page of commits doesn't have to
+		jobs::post([body = std::move(body)]
 		{
-			g_commits_since_compile = json::parse(body).get<std::vector<commit_entry>>();
-			g_update_needed = true;
-		}
-		catch(const std::exception&)
-		{
-			// Do nothing. Something is malformed.
-		}
+			try
+			{
+				g_commits_since_compile = json::parse(body).get<std::vector<commit_entry>>();
+				g_update_needed = true;
+			}
+			catch(const std::exception&)
+			{
+				// Do nothing. Something is malformed.
+			}
+		});
 	}
 
 	s_steam_http->ReleaseHTTPRequest(pvParam->m_hRequest);
@@ -23,6 +23,7 @@
 * SOFTWARE.
 */
 #pragma once
+#include <atomic>
 #include <string>
 #include <vector>
 
@@ -35,5 +36,6 @@ struct commit_entry
 	std::string message;
 };
 
-extern bool g_update_needed;
+// Set from a pool job once the response is parsed, read the commits only after this is true
+extern std::atomic<bool> g_update_needed;
 extern std::vector<commit_entry> g_commits_since_compile;
\ No newline at end of file
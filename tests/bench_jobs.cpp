@@ -0,0 +1,95 @@
+#include "jobs.hpp"
+#include "parallel.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <thread>
+#include <vector>
+
+// Throughput of the job pool with as many workers as in game. Run by hand:
+// bench_jobs [job count]
+namespace
+{
+	using clock = std::chrono::steady_clock;
+
+	auto report(const char* name, const std::size_t count, const clock::time_point start) -> void
+	{
+		const auto seconds = std::chrono::duration<double>(clock::now() - start).count();
+		std::printf("%-28s %10zu jobs %9.2f ms %12.0f jobs/s\n", name, count, seconds * 1000.0, double(count) / seconds);
+	}
+
+	auto wait_for(const std::atomic<std::size_t>& counter, const std::size_t count) -> void
+	{
+		while(counter.load() < count)
+			std::this_thread::yield();
+	}
+
+	// Posted from a thread that isn't a worker, spread round robin
+	auto bench_external_posts(const std::size_t count) -> void
+	{
+		std::atomic<std::size_t> done{ 0 };
+		const auto start = clock::now();
+		for(auto i = std::size_t(0); i < count; ++i)
+			jobs::post([&done] { ++done; });
+		wait_for(done, count);
+		report("post from outside", count, start);
+	}
+
+	// Posted from a worker to its own deque, the others steal
+	auto bench_worker_posts(const std::size_t count) -> void
+	{
+		std::atomic<std::size_t> done{ 0 };
+		const auto start = clock::now();
+		jobs::post([&done, count]
+		{
+			for(auto i = std::size_t(0); i < count; ++i)
+				jobs::post([&done] { ++done; });
+		});
+		wait_for(done, count);
+		report("post from a worker", count, start);
+	}
+
+	auto bench_submit(const std::size_t count) -> void
+	{
+		std::vector<std::future<void>> futures;
+		futures.reserve(count);
+		const auto start = clock::now();
+		for(auto i = std::size_t(0); i < count; ++i)
+			futures.push_back(jobs::submit([] {}));
+		for(auto& future : futures)
+			future.wait();
+		report("submit and wait", count, start);
+	}
+
+	auto bench_for_each_index(const std::size_t count) -> void
+	{
+		std::atomic<std::size_t> sum{ 0 };
+		const auto start = clock::now();
+		parallel::for_each_index(count, [&sum](const std::size_t i) { sum += i & 1; });
+		report("parallel::for_each_index", count, start);
+	}
+}
+
+auto main(const int argc, char** argv) -> int
+{
+	const auto count = argc > 1 ? std::size_t(std::strtoull(argv[1], nullptr, 10)) : std::size_t(200000);
+
+	std::printf("workers: %zu\n", jobs::worker_count());
+
+	// Starts the pool outside the timings
+	jobs::submit([] {}).wait();
+
+	bench_external_posts(count);
+	bench_worker_posts(count);
+	bench_submit(count);
+	bench_for_each_index(count);
+
+	const auto stats = jobs::get_stats();
+	std::printf("executed %zu, stolen %zu\n", stats.executed, stats.stolen);
+
+	jobs::shutdown();
+	return 0;
+}
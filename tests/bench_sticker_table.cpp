@@ -0,0 +1,145 @@
+#include "sticker_table.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+
+// Replays what the GetStickerAttributeBySlotIndex hooks are asked while
+// stickered weapons are drawn: for every weapon, every slot's kit through the
+// int hook and its wear, scale and rotation through the float hook. Compares
+// the table against the config lookup the hooks did per call before it. Run
+// by hand: bench_sticker_table [frames]
+namespace
+{
+	using clock = std::chrono::steady_clock;
+
+	constexpr auto k_weapons_per_frame = 24;
+
+	// What the hooks did before: config::get_by_definition_index and a
+	// bounds checked stickers.at(slot)
+	auto config_lookup(const std::vector<item_setting>& items, const int defindex, const int slot, sticker_table::attributes& out) -> bool
+	{
+		const auto it = std::find_if(items.begin(), items.end(), [defindex](const item_setting& e)
+		{
+			return e.enabled && e.definition_index == defindex;
+		});
+		if(it == items.end())
+			return false;
+
+		const auto& sticker = it->stickers.at(slot);
+		out = { sticker.kit, sticker.wear, sticker.scale, sticker.rotation };
+		return true;
+	}
+
+	auto table_lookup(const sticker_table& table, const int defindex, const int slot, sticker_table::attributes& out) -> bool
+	{
+		if(slot < 0 || slot >= sticker_table::k_slots || !sticker_table::covers(defindex))
+			return false;
+
+		const auto attributes = table.find(defindex, slot);
+		if(!attributes)
+			return false;
+
+		out = *attributes;
+		return true;
+	}
+
+	// A full config, one entry per weapon with every slot stickered
+	auto make_items() -> std::vector<item_setting>
+	{
+		std::vector<item_setting> items;
+		for(auto defindex = 1; defindex <= 64; ++defindex)
+		{
+			item_setting item;
+			item.enabled = true;
+			item.definition_index = defindex;
+			for(auto slot = 0; slot < sticker_table::k_slots; ++slot)
+				item.stickers[slot] = { defindex * 10 + slot, 0, 0.1f * slot, 1.f, 15.f * slot };
+			items.push_back(item);
+		}
+		return items;
+	}
+
+	// Which weapons are on screen, some of them without a config
+	auto make_frames(const int frames) -> std::vector<int>
+	{
+		std::mt19937 random(42);
+		std::uniform_int_distribution<int> defindex(1, 80);
+
+		std::vector<int> weapons(std::size_t(frames) * k_weapons_per_frame);
+		for(auto& weapon : weapons)
+			weapon = defindex(random);
+		return weapons;
+	}
+
+	template <typename Lookup>
+	auto replay(const char* name, const std::vector<int>& weapons, Lookup lookup) -> double
+	{
+		auto checksum = 0.0;
+		auto calls = std::size_t(0);
+
+		const auto start = clock::now();
+		for(const auto defindex : weapons)
+		{
+			for(auto slot = 0; slot < sticker_table::k_slots; ++slot)
+			{
+				sticker_table::attributes attributes;
+
+				// Int hook for the kit, float hook for each of the rest
+				if(lookup(defindex, slot, attributes))
+					checksum += attributes.kit;
+				if(lookup(defindex, slot, attributes))
+					checksum += attributes.wear;
+				if(lookup(defindex, slot, attributes))
+					checksum += attributes.scale;
+				if(lookup(defindex, slot, attributes))
+					checksum += attributes.rotation;
+				calls += 4;
+			}
+		}
+		const auto seconds = std::chrono::duration<double>(clock::now() - start).count();
+
+		std::printf("%-14s %10zu calls %9.2f ms %8.2f ns/call  checksum %.1f\n",
+			name, calls, seconds * 1000.0, seconds * 1e9 / double(calls), checksum);
+		return checksum;
+	}
+}
+
+auto main(const int argc, char** argv) -> int
+{
+	const auto frames = argc > 1 ? std::atoi(argv[1]) : 20000;
+
+	const auto items = make_items();
+	const auto weapons = make_frames(frames);
+
+	auto table = std::make_unique<sticker_table>();
+	const auto build_start = clock::now();
+	table->build(items);
+	const auto build_us = std::chrono::duration<double, std::micro>(clock::now() - build_start).count();
+
+	std::printf("%d frames, %d weapons each, %zu configured items, table built in %.1f us\n",
+		frames, k_weapons_per_frame, items.size(), build_us);
+
+	const auto from_config = replay("config lookup", weapons, [&items](const int defindex, const int slot, sticker_table::attributes& out)
+	{
+		return config_lookup(items, defindex, slot, out);
+	});
+
+	const auto from_table = replay("table", weapons, [&table](const int defindex, const int slot, sticker_table::attributes& out)
+	{
+		return table_lookup(*table, defindex, slot, out);
+	});
+
+	// Both have to hand out the same attributes
+	if(from_config != from_table)
+	{
+		std::puts("checksums differ");
+		return 1;
+	}
+
+	return 0;
+}
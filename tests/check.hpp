@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdio>
+#include <cstdlib>
+
+// Ends the test with the failed expression, there's no framework to report to
+#define CHECK(expr) \
+	do \
+	{ \
+		if(!(expr)) \
+		{ \
+			std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #expr); \
+			std::exit(1); \
+		} \
+	} while(false)
+
+#define CHECK_THROWS(expr) \
+	do \
+	{ \
+		auto threw = false; \
+		try \
+		{ \
+			expr; \
+		} \
+		catch(...) \
+		{ \
+			threw = true; \
+		} \
+		CHECK(threw && #expr " throws"); \
+	} while(false)
@@ -0,0 +1,129 @@
+#include "check.hpp"
+#include "jobs.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	auto spin_for(const std::chrono::microseconds duration) -> void
+	{
+		const auto end = std::chrono::steady_clock::now() + duration;
+		while(std::chrono::steady_clock::now() < end)
+		{
+		}
+	}
+
+	auto test_submit_returns_value() -> void
+	{
+		auto future = jobs::submit([] { return 42; });
+		CHECK(future.get() == 42);
+	}
+
+	auto test_submit_keeps_exception() -> void
+	{
+		auto future = jobs::submit([]() -> int { throw std::runtime_error("job failed"); });
+		CHECK_THROWS(future.get());
+	}
+
+	auto test_every_post_runs() -> void
+	{
+		std::atomic<int> counter{ 0 };
+		std::vector<std::future<void>> futures;
+		for(auto i = 0; i < 1000; ++i)
+			futures.push_back(jobs::submit([&counter] { ++counter; }));
+
+		for(auto& future : futures)
+			future.wait();
+
+		CHECK(counter == 1000);
+	}
+
+	// A worker's own posts go to its deque, idle workers have to steal them
+	auto test_idle_workers_steal() -> void
+	{
+		const auto stolen_before = jobs::get_stats().stolen;
+
+		std::vector<std::future<void>> futures;
+		jobs::submit([&futures]
+		{
+			for(auto i = 0; i < 200; ++i)
+				futures.push_back(jobs::submit([] { spin_for(std::chrono::microseconds(200)); }));
+		}).get();
+
+		for(auto& future : futures)
+			future.get();
+
+		CHECK(jobs::get_stats().workers == 4);
+		CHECK(jobs::get_stats().stolen > stolen_before);
+	}
+
+	// Last, the pool can't be restarted
+	auto test_shutdown_cancels_queued() -> void
+	{
+		std::promise<void> gate;
+		const auto gate_future = gate.get_future().share();
+
+		// Every worker blocked, so the next posts stay queued
+		std::atomic<int> blocked{ 0 };
+		std::vector<std::future<void>> running;
+		for(auto i = 0; i < 4; ++i)
+			running.push_back(jobs::submit([&blocked, gate_future]
+			{
+				++blocked;
+				gate_future.wait();
+			}));
+
+		while(blocked < 4)
+			std::this_thread::yield();
+
+		std::vector<std::future<void>> queued;
+		for(auto i = 0; i < 10; ++i)
+			queued.push_back(jobs::submit([] {}));
+
+		const auto cancelled_before = jobs::get_stats().cancelled;
+
+		auto stopper = std::thread([] { jobs::shutdown(); });
+		while(!jobs::is_stopping())
+			std::this_thread::yield();
+		gate.set_value();
+		stopper.join();
+
+		for(auto& future : running)
+			future.get();
+
+		for(auto& future : queued)
+		{
+			auto broken = false;
+			try
+			{
+				future.get();
+			}
+			catch(const std::future_error& error)
+			{
+				broken = error.code() == std::future_errc::broken_promise;
+			}
+			CHECK(broken);
+		}
+
+		CHECK(jobs::get_stats().cancelled == cancelled_before + 10);
+		CHECK(!jobs::post([] {}));
+	}
+}
+
+auto main() -> int
+{
+	test_submit_returns_value();
+	test_submit_keeps_exception();
+	test_every_post_runs();
+	test_idle_workers_steal();
+	test_shutdown_cancels_queued();
+
+	std::puts("jobs: ok");
+	return 0;
+}
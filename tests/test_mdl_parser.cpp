@@ -0,0 +1,303 @@
+#include "check.hpp"
+#include "mdl_parser.hpp"
+#include "model_validator.hpp"
+#include "Utilities/jobs.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// studiohdr_t fields the parser reads
+	constexpr std::size_t k_version = 4;
+	constexpr std::size_t k_name = 12;
+	constexpr std::size_t k_length = 76;
+	constexpr std::size_t k_num_bones = 156;
+	constexpr std::size_t k_bone_index = 160;
+	constexpr std::size_t k_num_local_seq = 188;
+	constexpr std::size_t k_local_seq_index = 192;
+	constexpr std::size_t k_num_textures = 204;
+	constexpr std::size_t k_texture_index = 208;
+	constexpr std::size_t k_num_cd_textures = 212;
+	constexpr std::size_t k_num_body_parts = 232;
+	constexpr std::size_t k_body_part_index = 236;
+
+	constexpr std::size_t k_sequence_size = 212;
+
+	auto write_i32(std::vector<std::uint8_t>& data, const std::size_t offset, const std::int32_t value) -> void
+	{
+		memcpy(data.data() + offset, &value, sizeof value);
+	}
+
+	// A header with empty tables and nothing after it
+	auto make_model(const std::size_t size = mdl::k_header_size) -> std::vector<std::uint8_t>
+	{
+		std::vector<std::uint8_t> data(size);
+		write_i32(data, 0, std::int32_t(mdl::k_studio_magic));
+		write_i32(data, k_version, 48);
+		strcpy(reinterpret_cast<char*>(data.data() + k_name), "weapons/v_knife_test.mdl");
+		write_i32(data, k_length, std::int32_t(size));
+		return data;
+	}
+
+	// Two sequences right after the header, their names after the table
+	auto make_model_with_sequences() -> std::vector<std::uint8_t>
+	{
+		const auto table = mdl::k_header_size;
+		const auto strings = table + 2 * k_sequence_size;
+		auto data = make_model(strings + 32);
+		write_i32(data, k_num_local_seq, 2);
+		write_i32(data, k_local_seq_index, std::int32_t(table));
+
+		// Name offsets are relative to their record
+		strcpy(reinterpret_cast<char*>(data.data() + strings), "idle");
+		strcpy(reinterpret_cast<char*>(data.data() + strings + 8), "ACT_VM_IDLE");
+		strcpy(reinterpret_cast<char*>(data.data() + strings + 24), "draw");
+		write_i32(data, table + 4, std::int32_t(strings - table));
+		write_i32(data, table + 8, std::int32_t(strings + 8 - table));
+		write_i32(data, table + 20, 1);
+		write_i32(data, table + k_sequence_size + 4, std::int32_t(strings + 24 - table - k_sequence_size));
+		return data;
+	}
+
+	auto parse(const std::vector<std::uint8_t>& data, const std::size_t size) -> mdl::parse_status
+	{
+		mdl::header_info header;
+		return mdl::parse_header(data.data(), size, header);
+	}
+
+	auto parse(const std::vector<std::uint8_t>& data) -> mdl::parse_status
+	{
+		return parse(data, data.size());
+	}
+
+	auto test_valid_header() -> void
+	{
+		const auto data = make_model();
+		mdl::header_info header;
+		CHECK(mdl::parse_header(data.data(), data.size(), header) == mdl::parse_status::ok);
+		CHECK(header.version == 48);
+		CHECK(header.length == int(mdl::k_header_size));
+		CHECK(strcmp(header.name, "weapons/v_knife_test.mdl") == 0);
+		CHECK(mdl::get_length(data.data()) == mdl::k_header_size);
+	}
+
+	auto test_short_buffers() -> void
+	{
+		const auto data = make_model();
+		mdl::header_info header;
+		CHECK(mdl::parse_header(nullptr, 0, header) == mdl::parse_status::too_small);
+		CHECK(parse(data, 0) == mdl::parse_status::too_small);
+		CHECK(parse(data, 4) == mdl::parse_status::too_small);
+		CHECK(parse(data, mdl::k_header_size - 1) == mdl::parse_status::too_small);
+	}
+
+	auto test_bad_magic_and_version() -> void
+	{
+		auto data = make_model();
+		data[0] = 'X';
+		CHECK(parse(data) == mdl::parse_status::bad_magic);
+		CHECK(mdl::get_length(data.data()) == 0);
+
+		for(const auto version : { 0, mdl::k_min_version - 1, mdl::k_max_version + 1, -1 })
+		{
+			data = make_model();
+			write_i32(data, k_version, version);
+			CHECK(parse(data) == mdl::parse_status::unsupported_version);
+		}
+	}
+
+	auto test_truncated_file() -> void
+	{
+		// Claims more than was read
+		auto data = make_model(mdl::k_header_size + 100);
+		CHECK(parse(data) == mdl::parse_status::ok);
+		CHECK(parse(data, data.size() - 1) == mdl::parse_status::truncated);
+		CHECK(parse(data, mdl::k_header_size) == mdl::parse_status::truncated);
+
+		// Claims less than a header
+		data = make_model();
+		write_i32(data, k_length, std::int32_t(mdl::k_header_size) - 1);
+		CHECK(parse(data) == mdl::parse_status::truncated);
+		CHECK(mdl::get_length(data.data()) == 0);
+
+		write_i32(data, k_length, -1);
+		CHECK(parse(data) == mdl::parse_status::truncated);
+
+		// Padding after the claimed length is fine
+		data = make_model();
+		data.resize(data.size() + 64);
+		CHECK(parse(data) == mdl::parse_status::ok);
+	}
+
+	auto test_tables_out_of_bounds() -> void
+	{
+		const auto header = std::int32_t(mdl::k_header_size);
+
+		// Negative count
+		auto data = make_model();
+		write_i32(data, k_num_bones, -1);
+		CHECK(parse(data) == mdl::parse_status::bad_bone_table);
+
+		// Over the studio.h limit
+		data = make_model();
+		write_i32(data, k_num_bones, 257);
+		write_i32(data, k_bone_index, header);
+		CHECK(parse(data) == mdl::parse_status::bad_bone_table);
+
+		// Starts inside the header
+		data = make_model(mdl::k_header_size + 216);
+		write_i32(data, k_num_bones, 1);
+		write_i32(data, k_bone_index, 0);
+		CHECK(parse(data) == mdl::parse_status::bad_bone_table);
+
+		// Exactly fits, then one record too many
+		write_i32(data, k_bone_index, header);
+		CHECK(parse(data) == mdl::parse_status::ok);
+		write_i32(data, k_num_bones, 2);
+		CHECK(parse(data) == mdl::parse_status::bad_bone_table);
+
+		data = make_model();
+		write_i32(data, k_num_local_seq, 1);
+		write_i32(data, k_local_seq_index, header);
+		CHECK(parse(data) == mdl::parse_status::bad_sequence_table);
+
+		data = make_model();
+		write_i32(data, k_num_textures, 1);
+		write_i32(data, k_texture_index, header);
+		CHECK(parse(data) == mdl::parse_status::bad_material_table);
+
+		data = make_model();
+		write_i32(data, k_num_cd_textures, -3);
+		CHECK(parse(data) == mdl::parse_status::bad_material_table);
+
+		data = make_model();
+		write_i32(data, k_num_body_parts, 1);
+		write_i32(data, k_body_part_index, 0x7fffffff);
+		CHECK(parse(data) == mdl::parse_status::bad_body_part_table);
+	}
+
+	auto test_sequences() -> void
+	{
+		const auto data = make_model_with_sequences();
+		std::vector<mdl::sequence_info> sequences;
+		CHECK(mdl::parse_sequences(data.data(), data.size(), sequences) == mdl::parse_status::ok);
+		CHECK(sequences.size() == 2);
+		CHECK(sequences[0].label == "idle");
+		CHECK(sequences[0].activity == "ACT_VM_IDLE");
+		CHECK(sequences[0].activity_weight == 1);
+		CHECK(sequences[1].label == "draw");
+		CHECK(sequences[1].activity.empty());
+
+		// A bad header leaves nothing behind
+		CHECK(mdl::parse_sequences(data.data(), data.size() - 1, sequences) == mdl::parse_status::truncated);
+		CHECK(sequences.empty());
+	}
+
+	auto test_sequence_names_out_of_bounds() -> void
+	{
+		const auto table = mdl::k_header_size;
+		auto data = make_model_with_sequences();
+
+		// Past the end
+		write_i32(data, table + 4, std::int32_t(data.size()));
+		// Not terminated before the end
+		memset(data.data() + data.size() - 8, 'x', 8);
+		write_i32(data, table + k_sequence_size + 4, std::int32_t(data.size() - 8 - table - k_sequence_size));
+
+		std::vector<mdl::sequence_info> sequences;
+		CHECK(mdl::parse_sequences(data.data(), data.size(), sequences) == mdl::parse_status::ok);
+		CHECK(sequences.size() == 2);
+		CHECK(sequences[0].label.empty());
+		CHECK(sequences[0].activity == "ACT_VM_IDLE");
+		CHECK(sequences[1].label.empty());
+	}
+
+	auto test_describe() -> void
+	{
+		CHECK(strcmp(mdl::describe(mdl::parse_status::ok), "valid") == 0);
+		CHECK(strcmp(mdl::describe(mdl::parse_status::truncated), "the file is truncated") == 0);
+		CHECK(strcmp(mdl::describe(mdl::parse_status(100)), "unknown error") == 0);
+	}
+
+	auto write_file(const std::filesystem::path& path, const std::vector<std::uint8_t>& data) -> void
+	{
+		std::filesystem::create_directories(path.parent_path());
+		std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(data.data()), std::streamsize(data.size()));
+	}
+
+	auto test_validator() -> void
+	{
+		const auto base = std::filesystem::temp_directory_path() / "nskinz_test_mdl";
+		std::filesystem::remove_all(base);
+
+		auto valid = make_model(mdl::k_header_size + 100);
+		write_file(base / "models/valid.mdl", valid);
+		valid.resize(valid.size() - 1);
+		write_file(base / "models/cut.mdl", valid);
+		write_file(base / "models/empty.mdl", {});
+
+		CHECK(model_validator::normalize_path("Models\\Valid.MDL") == "models/valid.mdl");
+
+		auto result = model_validator::validate_file(base.string(), "models/valid.mdl");
+		CHECK(result.is_valid());
+		CHECK(result.file_size == mdl::k_header_size + 100);
+
+		result = model_validator::validate_file(base.string(), "models/cut.mdl");
+		CHECK(result.status == mdl::parse_status::truncated);
+		CHECK(result.is_rejected());
+
+		result = model_validator::validate_file(base.string(), "models/empty.mdl");
+		CHECK(result.status == mdl::parse_status::io_error);
+
+		result = model_validator::validate_file(base.string(), "models/missing.mdl");
+		CHECK(result.status == mdl::parse_status::io_error);
+
+		// May be in a VPK, left to the engine
+		CHECK(!result.is_valid());
+		CHECK(!result.is_rejected());
+
+		// A rewritten file is checked again, not taken from the cache
+		write_file(base / "models/valid.mdl", make_model(mdl::k_header_size + 50));
+		result = model_validator::validate_file(base.string(), "models/valid.mdl");
+		CHECK(result.is_valid());
+		CHECK(result.file_size == mdl::k_header_size + 50);
+
+		model_validator::validate_library_async(base.string(), { "models/valid.mdl", "models/cut.mdl", "models/missing.mdl" });
+		while(model_validator::is_running())
+			std::this_thread::yield();
+
+		const auto results = model_validator::get_results();
+		CHECK(results->size() == 3);
+		CHECK(model_validator::find(*results, "MODELS/VALID.MDL")->is_valid());
+		CHECK(model_validator::find(*results, "Models\\Cut.mdl")->status == mdl::parse_status::truncated);
+		CHECK(model_validator::find(*results, "models/other.mdl") == nullptr);
+		CHECK(model_validator::get_last_stats().invalid == 2);
+
+		model_validator::shutdown();
+		jobs::shutdown();
+		std::filesystem::remove_all(base);
+	}
+}
+
+auto main() -> int
+{
+	test_valid_header();
+	test_short_buffers();
+	test_bad_magic_and_version();
+	test_truncated_file();
+	test_tables_out_of_bounds();
+	test_sequences();
+	test_sequence_names_out_of_bounds();
+	test_describe();
+	test_validator();
+
+	std::puts("mdl_parser: ok");
+	return 0;
+}
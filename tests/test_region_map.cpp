@@ -0,0 +1,167 @@
+#include "check.hpp"
+#include "region_map.hpp"
+
+#include <bitset>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace
+{
+	using region = platform::region_map::region;
+
+	auto same(const platform::region_map& map, const std::vector<region>& expected) -> bool
+	{
+		const auto& regions = map.get_regions();
+		if(regions.size() != expected.size())
+			return false;
+
+		for(auto i = std::size_t(0); i < regions.size(); ++i)
+			if(regions[i].begin != expected[i].begin || regions[i].end != expected[i].end)
+				return false;
+
+		return true;
+	}
+
+	auto test_contains_bounds() -> void
+	{
+		platform::region_map map;
+		CHECK(!map.contains(0));
+
+		map.assign({ { 0x1000, 0x2000 }, { 0x3000, 0x3001 } });
+		CHECK(!map.contains(0xfff));
+		CHECK(map.contains(0x1000));
+		CHECK(map.contains(0x1fff));
+		CHECK(!map.contains(0x2000)); // End is exclusive
+		CHECK(!map.contains(0x2fff));
+		CHECK(map.contains(0x3000));
+		CHECK(!map.contains(0x3001));
+		CHECK(!map.contains(~std::uintptr_t(0)));
+	}
+
+	auto test_assign_merges() -> void
+	{
+		platform::region_map map;
+
+		// Unsorted, one inside another, overlapping, adjacent, empty and inverted
+		map.assign({
+			{ 0x5000, 0x6000 },
+			{ 0x1000, 0x4000 },
+			{ 0x2000, 0x3000 },
+			{ 0x3800, 0x4800 },
+			{ 0x4800, 0x4900 },
+			{ 0x7000, 0x7000 },
+			{ 0x9000, 0x8000 },
+			{ 0x6000, 0x6100 }
+		});
+		CHECK(same(map, { { 0x1000, 0x4900 }, { 0x5000, 0x6100 } }));
+
+		// Replaces, doesn't add
+		map.assign({ { 0x10, 0x20 } });
+		CHECK(same(map, { { 0x10, 0x20 } }));
+
+		map.assign({});
+		CHECK(map.size() == 0);
+	}
+
+	auto test_insert_merges() -> void
+	{
+		platform::region_map map;
+		map.insert({ 0x1000, 0x2000 });
+		map.insert({ 0x4000, 0x5000 });
+		map.insert({ 0x7000, 0x8000 });
+		CHECK(map.size() == 3);
+
+		// Empty and inverted are ignored
+		map.insert({ 0x3000, 0x3000 });
+		map.insert({ 0x3100, 0x3000 });
+		CHECK(map.size() == 3);
+
+		// In a gap, touching neither
+		map.insert({ 0x2800, 0x3000 });
+		CHECK(same(map, { { 0x1000, 0x2000 }, { 0x2800, 0x3000 }, { 0x4000, 0x5000 }, { 0x7000, 0x8000 } }));
+
+		// Adjacent on both sides closes the gap
+		map.insert({ 0x2000, 0x2800 });
+		CHECK(same(map, { { 0x1000, 0x3000 }, { 0x4000, 0x5000 }, { 0x7000, 0x8000 } }));
+
+		// Adjacent below only, then above only
+		map.insert({ 0x3000, 0x3100 });
+		map.insert({ 0x6f00, 0x7000 });
+		CHECK(same(map, { { 0x1000, 0x3100 }, { 0x4000, 0x5000 }, { 0x6f00, 0x8000 } }));
+
+		// Inside an existing one
+		map.insert({ 0x4100, 0x4200 });
+		CHECK(same(map, { { 0x1000, 0x3100 }, { 0x4000, 0x5000 }, { 0x6f00, 0x8000 } }));
+
+		// Overlapping the ends of two
+		map.insert({ 0x4f00, 0x7100 });
+		CHECK(same(map, { { 0x1000, 0x3100 }, { 0x4000, 0x8000 } }));
+
+		// Before and after everything
+		map.insert({ 0x100, 0x200 });
+		map.insert({ 0x9000, 0xa000 });
+		CHECK(same(map, { { 0x100, 0x200 }, { 0x1000, 0x3100 }, { 0x4000, 0x8000 }, { 0x9000, 0xa000 } }));
+
+		// Covering all of them
+		map.insert({ 0x0, 0x10000 });
+		CHECK(same(map, { { 0x0, 0x10000 } }));
+
+		map.clear();
+		CHECK(map.size() == 0);
+		CHECK(!map.contains(0x1000));
+	}
+
+	// Random regions against a plain bitmap of the same addresses
+	auto test_against_bitmap() -> void
+	{
+		constexpr std::size_t k_space = 512;
+		std::mt19937 random(1234);
+		std::uniform_int_distribution<std::uintptr_t> address(0, k_space);
+
+		for(auto round = 0; round < 200; ++round)
+		{
+			platform::region_map inserted;
+			std::bitset<k_space> expected;
+			std::vector<region> regions;
+
+			for(auto n = 0; n < 20; ++n)
+			{
+				const auto a = address(random);
+				const auto b = address(random);
+				const auto r = region{ (std::min)(a, b), (std::max)(a, b) };
+				regions.push_back(r);
+				inserted.insert(r);
+				for(auto i = r.begin; i < r.end; ++i)
+					expected.set(i);
+			}
+
+			platform::region_map assigned;
+			assigned.assign(regions);
+			CHECK(inserted.get_regions().size() == assigned.get_regions().size());
+
+			for(auto i = std::size_t(0); i <= k_space; ++i)
+			{
+				const auto want = i < k_space && expected.test(i);
+				CHECK(inserted.contains(i) == want);
+				CHECK(assigned.contains(i) == want);
+			}
+
+			// Sorted, and touching regions were merged
+			const auto& merged = inserted.get_regions();
+			for(auto i = std::size_t(1); i < merged.size(); ++i)
+				CHECK(merged[i - 1].end < merged[i].begin);
+		}
+	}
+}
+
+auto main() -> int
+{
+	test_contains_bounds();
+	test_assign_merges();
+	test_insert_merges();
+	test_against_bitmap();
+
+	std::puts("region_map: ok");
+	return 0;
+}
@@ -0,0 +1,112 @@
+#include "check.hpp"
+#include "task_graph.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	using affinity = task_graph::affinity;
+
+	struct run_log
+	{
+		std::mutex mutex;
+		std::vector<int> order;
+
+		auto add(const int step) -> void
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			order.push_back(step);
+		}
+
+		auto ran(const int step) -> bool
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for(const auto s : order)
+				if(s == step)
+					return true;
+			return false;
+		}
+
+		auto position(const int step) -> std::size_t
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for(auto i = std::size_t(0); i < order.size(); ++i)
+				if(order[i] == step)
+					return i;
+			return order.size();
+		}
+	};
+
+	// 0 throws; 1 depends on it and 3 on 1, so both are skipped; 2 and 4 don't care
+	auto run_failing_graph(const bool parallel) -> void
+	{
+		run_log log;
+		task_graph graph;
+
+		const auto failing = graph.add("failing", affinity::any, [&log] { log.add(0); throw std::runtime_error("step failed"); });
+		const auto dependent = graph.add("dependent", affinity::any, [&log] { log.add(1); }, { failing });
+		const auto independent = graph.add("independent", affinity::any, [&log] { log.add(2); });
+		graph.add("transitive", affinity::caller, [&log] { log.add(3); }, { dependent });
+		graph.add("after independent", affinity::caller, [&log] { log.add(4); }, { independent });
+
+		CHECK_THROWS(parallel ? graph.run_parallel() : graph.run_serial());
+
+		CHECK(log.ran(0));
+		CHECK(!log.ran(1));
+		CHECK(log.ran(2));
+		CHECK(!log.ran(3));
+		CHECK(log.ran(4));
+	}
+
+	auto test_serial_skips_dependents_of_failures() -> void
+	{
+		run_failing_graph(false);
+	}
+
+	auto test_parallel_skips_dependents_of_failures() -> void
+	{
+		run_failing_graph(true);
+	}
+
+	auto test_parallel_follows_dependencies() -> void
+	{
+		run_log log;
+		task_graph graph;
+		const auto caller = std::this_thread::get_id();
+		std::atomic<bool> caller_step_on_caller{ false };
+
+		const auto a = graph.add("a", affinity::any, [&log] { log.add(0); });
+		const auto b = graph.add("b", affinity::any, [&log] { log.add(1); });
+		const auto c = graph.add("c", affinity::caller, [&]
+		{
+			log.add(2);
+			caller_step_on_caller = std::this_thread::get_id() == caller;
+		}, { a, b });
+		graph.add("d", affinity::any, [&log] { log.add(3); }, { c });
+
+		const auto stats = graph.run_parallel();
+
+		CHECK(stats.parallel);
+		CHECK(caller_step_on_caller);
+		CHECK(log.position(0) < log.position(2));
+		CHECK(log.position(1) < log.position(2));
+		CHECK(log.position(2) < log.position(3));
+		CHECK(log.order.size() == 4);
+	}
+}
+
+auto main() -> int
+{
+	test_serial_skips_dependents_of_failures();
+	test_parallel_skips_dependents_of_failures();
+	test_parallel_follows_dependencies();
+
+	std::puts("task_graph: ok");
+	jobs::shutdown();
+	return 0;
+}
@@ -0,0 +1,84 @@
+#include "check.hpp"
+#include "thread_slots.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	struct counter
+	{
+		std::atomic<int> value{ 0 };
+	};
+
+	auto test_same_thread_same_slot() -> void
+	{
+		thread_slots<counter, 4> slots;
+		const auto first = slots.get();
+		CHECK(first != nullptr);
+		CHECK(slots.get() == first);
+	}
+
+	auto test_threads_get_their_own_slots() -> void
+	{
+		thread_slots<counter, 8> slots;
+
+		std::vector<std::thread> threads;
+		for(auto i = 0; i < 8; ++i)
+			threads.emplace_back([&slots]
+			{
+				for(auto n = 0; n < 1000; ++n)
+					++slots.get()->value;
+			});
+
+		for(auto& thread : threads)
+			thread.join();
+
+		auto seen = 0;
+		slots.for_each([&seen](counter& c, std::size_t)
+		{
+			CHECK(c.value == 1000);
+			++seen;
+		});
+		CHECK(seen == 8);
+	}
+
+	auto test_full_slots_return_null() -> void
+	{
+		thread_slots<counter, 2> slots;
+		CHECK(slots.get() != nullptr);
+
+		// Both alive at once, a finished thread's id can be handed out again
+		counter* second = nullptr;
+		counter* third = nullptr;
+		std::atomic<bool> second_done{ false };
+		std::atomic<bool> third_done{ false };
+		auto second_thread = std::thread([&]
+		{
+			second = slots.get();
+			second_done = true;
+			while(!third_done)
+				std::this_thread::yield();
+		});
+		while(!second_done)
+			std::this_thread::yield();
+		std::thread([&] { third = slots.get(); }).join();
+		third_done = true;
+		second_thread.join();
+
+		CHECK(second != nullptr);
+		CHECK(third == nullptr);
+	}
+}
+
+auto main() -> int
+{
+	test_same_thread_same_slot();
+	test_threads_get_their_own_slots();
+	test_full_slots_return_null();
+
+	std::puts("thread_slots: ok");
+	return 0;
+}